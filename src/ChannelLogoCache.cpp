@@ -0,0 +1,377 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChannelLogoCache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <json/json.h>
+#include <kodi/Filesystem.h>
+#include <memory>
+
+namespace
+{
+const char* LOGOCACHE_INDEX = "index.json";
+const int LOGOCACHE_INDEX_VERSION = 1;
+
+// 64-bit FNV-1a, plenty to tell a few hundred logos apart
+uint64_t HashImage(const std::string& image)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : image)
+  {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+} // unnamed namespace
+
+CChannelLogoCache::~CChannelLogoCache()
+{
+  Stop();
+}
+
+void CChannelLogoCache::Start(const std::string& directory,
+                              uint64_t maxSize,
+                              const FetchFunction& fetch,
+                              const ChangedCallback& onChanged)
+{
+  Stop();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (directory != m_directory)
+  {
+    m_directory = directory;
+    m_entries.clear();
+    m_files.clear();
+    m_totalSize = 0;
+    if (!kodi::vfs::DirectoryExists(m_directory) && !kodi::vfs::CreateDirectory(m_directory))
+      kodi::Log(ADDON_LOG_ERROR, "Unable to create the channel logo directory %s",
+                m_directory.c_str());
+    LoadIndex();
+  }
+  m_maxSize = maxSize;
+  m_fetch = fetch;
+  m_onChanged = onChanged;
+  // Channels shown from now on are the current ones, their logos are never evicted
+  m_sessionStart = m_sequence;
+  for (int i = 0; i < LOGOCACHE_WORKERS; i++)
+    m_workers.emplace_back(&CChannelLogoCache::Process, this);
+}
+
+void CChannelLogoCache::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (std::thread& worker : m_workers)
+    worker.join();
+  m_workers.clear();
+
+  // Logos are checked again after the next start
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queue.clear();
+  for (auto& entry : m_entries)
+    entry.second.checked = false;
+  m_changed = false;
+  m_stop = false;
+  SaveIndex();
+}
+
+std::string CChannelLogoCache::GetLogoPath(const std::string& channelGUID)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Entry& entry = m_entries[channelGUID];
+  entry.used = ++m_sequence;
+  if (!entry.checked && !m_workers.empty())
+  {
+    entry.checked = true;
+    m_queue.push_back(channelGUID);
+    m_condition.notify_one();
+  }
+  return entry.file;
+}
+
+void CChannelLogoCache::Process()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+    if (m_stop)
+      return;
+
+    std::string channelGUID = m_queue.front();
+    m_queue.pop_front();
+    const Entry& known = m_entries[channelGUID];
+    std::string knownFile = known.file;
+    std::string etag = known.etag;
+    time_t modified = known.modified;
+    m_active++;
+    lock.unlock();
+
+    // Download the logo again when its file was removed behind our back
+    if (!knownFile.empty() && !kodi::vfs::FileExists(knownFile))
+    {
+      etag.clear();
+      modified = 0;
+    }
+
+    std::string image;
+    std::string file;
+    bool stored = false;
+    int status = m_fetch(channelGUID, modified, etag, image);
+    if (status == 200)
+    {
+      // Hold a reference while storing, so that no other worker removes a file found here
+      file = FileName(image);
+      lock.lock();
+      AddReference(file);
+      lock.unlock();
+      stored = StoreImage(channelGUID, image, file);
+    }
+    time_t now = time(nullptr);
+
+    lock.lock();
+    m_active--;
+    Entry& entry = m_entries[channelGUID];
+    if (stored || status == 204)
+    {
+      if (entry.file != file)
+      {
+        std::string previous = entry.file;
+        entry.file = file;
+        AddReference(file, image.size());
+        ReleaseFile(previous);
+        m_changed = true;
+      }
+      entry.etag = etag;
+      entry.modified = now;
+      m_indexChanged = true;
+    }
+    else if (status != 304)
+    {
+      // Try again with the next channel list update
+      entry.checked = false;
+    }
+
+    if (status == 200)
+      ReleaseFile(file);
+
+    if (m_queue.empty() && m_active == 0)
+    {
+      // All current channels have been seen by now
+      EnforceSizeLimit();
+      if (m_indexChanged)
+        SaveIndex();
+
+      // Let Kodi pick up the new paths once, when all queued logos are done
+      if (m_changed)
+      {
+        m_changed = false;
+        ChangedCallback onChanged = m_onChanged;
+        lock.unlock();
+        kodi::Log(ADDON_LOG_DEBUG, "Channel logos changed, updating the channels");
+        onChanged();
+        lock.lock();
+      }
+    }
+  }
+}
+
+std::string CChannelLogoCache::FileName(const std::string& image) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016" PRIx64 ".png", HashImage(image));
+  return m_directory + name;
+}
+
+bool CChannelLogoCache::StoreImage(const std::string& channelGUID,
+                                   const std::string& image,
+                                   const std::string& file)
+{
+  if (kodi::vfs::FileExists(file))
+    return true;
+
+  // Write a temporary file first, so that Kodi never reads a partial logo
+  std::string tmpfile = m_directory + channelGUID + ".$$$";
+  kodi::vfs::CFile output;
+  bool written = output.OpenFileForWrite(tmpfile, true) &&
+                 output.Write(image.data(), image.size()) == static_cast<ssize_t>(image.size());
+  output.Close();
+  bool renamed = written && kodi::vfs::RenameFile(tmpfile, file);
+  if (!renamed)
+    kodi::vfs::DeleteFile(tmpfile);
+
+  // Another worker may have stored the same logo in the meantime
+  if (!renamed && !kodi::vfs::FileExists(file))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "couldn't store the logo of channel %s as %s.",
+              channelGUID.c_str(), file.c_str());
+    return false;
+  }
+  return true;
+}
+
+void CChannelLogoCache::AddReference(const std::string& file, uint64_t size)
+{
+  if (file.empty())
+    return;
+  File& known = m_files[file];
+  known.references++;
+  if (known.size == 0 && size > 0)
+  {
+    known.size = size;
+    m_totalSize += size;
+  }
+}
+
+void CChannelLogoCache::ReleaseFile(const std::string& file)
+{
+  auto it = m_files.find(file);
+  if (it == m_files.end() || --it->second.references > 0)
+    return;
+
+  m_totalSize -= it->second.size;
+  m_files.erase(it);
+  kodi::vfs::DeleteFile(file);
+}
+
+void CChannelLogoCache::EnforceSizeLimit()
+{
+  if (m_totalSize <= m_maxSize)
+    return;
+
+  // A file is as recently used as the most recently shown channel with it. Files of channels
+  // shown since the start stay, the other ones are removed least recently used first.
+  std::unordered_set<std::string> current;
+  std::unordered_map<std::string, uint64_t> fileUsed;
+  for (const auto& entry : m_entries)
+  {
+    if (entry.second.file.empty())
+      continue;
+    if (entry.second.used > m_sessionStart)
+      current.insert(entry.second.file);
+    uint64_t& used = fileUsed[entry.second.file];
+    used = std::max(used, entry.second.used);
+  }
+  std::vector<std::pair<uint64_t, std::string>> victims;
+  for (const auto& file : fileUsed)
+  {
+    if (current.find(file.first) == current.end())
+      victims.emplace_back(file.second, file.first);
+  }
+  std::sort(victims.begin(), victims.end());
+
+  for (const auto& victim : victims)
+  {
+    if (m_totalSize <= m_maxSize)
+      break;
+    kodi::Log(ADDON_LOG_DEBUG, "Removing channel logo %s, the cache exceeds its size limit",
+              victim.second.c_str());
+    for (auto& entry : m_entries)
+    {
+      if (entry.second.file == victim.second)
+      {
+        entry.second.file.clear();
+        entry.second.etag.clear();
+        entry.second.modified = 0;
+        ReleaseFile(victim.second);
+      }
+    }
+    m_indexChanged = true;
+  }
+}
+
+void CChannelLogoCache::LoadIndex()
+{
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(m_directory + LOGOCACHE_INDEX))
+    return;
+
+  std::string data;
+  char buffer[4096];
+  ssize_t bytesRead;
+  while ((bytesRead = file.Read(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, static_cast<size_t>(bytesRead));
+
+  Json::Value index;
+  std::string error;
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> const reader(builder.newCharReader());
+  if (!reader->parse(data.c_str(), data.c_str() + data.size(), &index, &error) ||
+      !index.isObject() || index["version"].asInt() != LOGOCACHE_INDEX_VERSION)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Ignoring the invalid channel logo index in %s",
+              m_directory.c_str());
+    return;
+  }
+
+  const Json::Value& logos = index["logos"];
+  for (Json::Value::ArrayIndex i = 0; i < logos.size(); i++)
+  {
+    const Json::Value& logo = logos[i];
+    Entry& entry = m_entries[logo["guid"].asString()];
+    if (!logo["file"].asString().empty())
+    {
+      entry.file = m_directory + logo["file"].asString();
+      AddReference(entry.file, logo["size"].asUInt64());
+    }
+    entry.etag = logo["etag"].asString();
+    entry.modified = static_cast<time_t>(logo["modified"].asInt64());
+    entry.used = logo["used"].asUInt64();
+    m_sequence = std::max(m_sequence, entry.used);
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "Loaded the channel logo index, %zu channels and %zu files",
+            m_entries.size(), m_files.size());
+}
+
+void CChannelLogoCache::SaveIndex()
+{
+  if (m_directory.empty())
+    return;
+
+  // File names are stored relative to the directory
+  Json::Value logos(Json::arrayValue);
+  for (const auto& entry : m_entries)
+  {
+    if (entry.second.modified == 0)
+      continue;
+    Json::Value logo;
+    logo["guid"] = entry.first;
+    if (!entry.second.file.empty())
+    {
+      logo["file"] = entry.second.file.substr(m_directory.size());
+      logo["size"] = static_cast<Json::UInt64>(m_files[entry.second.file].size);
+    }
+    logo["etag"] = entry.second.etag;
+    logo["modified"] = static_cast<Json::Int64>(entry.second.modified);
+    logo["used"] = static_cast<Json::UInt64>(entry.second.used);
+    logos.append(logo);
+  }
+  Json::Value index;
+  index["version"] = LOGOCACHE_INDEX_VERSION;
+  index["logos"] = logos;
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  std::string data = Json::writeString(builder, index);
+
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(m_directory + LOGOCACHE_INDEX, true) ||
+      file.Write(data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Unable to write the channel logo index in %s",
+              m_directory.c_str());
+    return;
+  }
+  m_indexChanged = false;
+}
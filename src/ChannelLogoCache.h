@@ -0,0 +1,123 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <kodi/AddonBase.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Number of logos that are downloaded at the same time
+#define LOGOCACHE_WORKERS 2
+
+/**
+ * \brief Local copies of the channel logos, downloaded in the background
+ *
+ * The logo path of a channel is returned at once from what is known locally. Every channel
+ * is revalidated once per connection by a small pool of worker threads. Logo files are named
+ * after a hash of their content, so a changed logo gets a new path and Kodi does not keep
+ * showing its own cached copy of the old one. Channels sharing a logo share its file.
+ *
+ * An index file in the cache directory keeps the file, ETag and download date of every
+ * channel across restarts. When the files exceed the size limit, the logos of channels that
+ * were not shown since the start are removed, least recently shown first. The logos of the
+ * current channels are always kept, even when they alone exceed the limit.
+ */
+class ATTR_DLL_LOCAL CChannelLogoCache
+{
+public:
+  /**
+   * \brief Downloads the logo of a channel, see CArgusTV::GetChannelLogo
+   * \return The HTTP status (200, 204 or 304) or a negative value on failure
+   */
+  using FetchFunction = std::function<int(const std::string& channelGUID,
+                                          time_t modifiedAfter,
+                                          std::string& etag,
+                                          std::string& image)>;
+  using ChangedCallback = std::function<void()>;
+
+  CChannelLogoCache() = default;
+  ~CChannelLogoCache();
+
+  /**
+   * \brief Load the index and start the download workers
+   * \param directory Directory the logo files are stored in, including the trailing separator
+   * \param maxSize   Upper bound on the total size of the logo files in bytes
+   * \param fetch     Downloads one logo, called from the workers
+   * \param onChanged Called when logo paths changed after the queue ran empty
+   */
+  void Start(const std::string& directory,
+             uint64_t maxSize,
+             const FetchFunction& fetch,
+             const ChangedCallback& onChanged);
+
+  /**
+   * \brief Stop the download workers, drop the queued downloads and save the index
+   */
+  void Stop();
+
+  /**
+   * \brief Path of the local copy of a channel logo, empty when there is none (yet)
+   *
+   * Queues a download when the logo has not been checked since the workers started.
+   */
+  std::string GetLogoPath(const std::string& channelGUID);
+
+private:
+  struct Entry
+  {
+    std::string file;
+    std::string etag;
+    time_t modified = 0;
+    uint64_t used = 0;
+    bool checked = false;
+  };
+
+  struct File
+  {
+    uint64_t size = 0;
+    unsigned int references = 0;
+  };
+
+  void Process();
+  std::string FileName(const std::string& image) const;
+  bool StoreImage(const std::string& channelGUID,
+                  const std::string& image,
+                  const std::string& file);
+  void AddReference(const std::string& file, uint64_t size = 0);
+  void ReleaseFile(const std::string& file);
+  void EnforceSizeLimit();
+  void LoadIndex();
+  void SaveIndex();
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::vector<std::thread> m_workers;
+  bool m_stop = false;
+  size_t m_active = 0;
+  bool m_changed = false;
+  bool m_indexChanged = false;
+  std::deque<std::string> m_queue;
+  std::unordered_map<std::string, Entry> m_entries;
+  std::unordered_map<std::string, File> m_files;
+  uint64_t m_totalSize = 0;
+  uint64_t m_sequence = 0;
+  uint64_t m_sessionStart = 0;
+  uint64_t m_maxSize = 0;
+  std::string m_directory;
+  FetchFunction m_fetch;
+  ChangedCallback m_onChanged;
+};
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChannelRegistry.h"
+
+CChannelRegistry::CChannelRegistry() : m_snapshot(std::make_shared<Snapshot>())
+{
+}
+
+void CChannelRegistry::Replace(CArgusTV::ChannelType type, const std::vector<ChannelPtr>& channels)
+{
+  // Writers build a new snapshot from the current one, readers keep using the old one
+  std::lock_guard<std::mutex> lock(m_updateMutex);
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->tv = (type == CArgusTV::Television) ? channels : Get()->tv;
+  snapshot->radio = (type == CArgusTV::Radio) ? channels : Get()->radio;
+
+  for (const auto* list : {&snapshot->tv, &snapshot->radio})
+  {
+    for (const ChannelPtr& channel : *list)
+    {
+      snapshot->byId.emplace(channel->ID(), channel);
+      // Several channels may share a guide channel, e.g. the SD and HD variant of a station
+      if (!channel->GuideChannelID().empty())
+        snapshot->byGuideChannelId[channel->GuideChannelID()].push_back(channel);
+    }
+  }
+
+  std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+CChannelRegistry::ChannelPtr CChannelRegistry::FindById(int id) const
+{
+  auto snapshot = Get();
+  auto it = snapshot->byId.find(id);
+  return it != snapshot->byId.end() ? it->second : nullptr;
+}
+
+std::vector<CChannelRegistry::ChannelPtr> CChannelRegistry::FindByGuideChannelId(
+    const std::string& guideChannelId) const
+{
+  auto snapshot = Get();
+  auto it = snapshot->byGuideChannelId.find(guideChannelId);
+  return it != snapshot->byGuideChannelId.end() ? it->second : std::vector<ChannelPtr>();
+}
+
+std::vector<CChannelRegistry::ChannelPtr> CChannelRegistry::All() const
+{
+  auto snapshot = Get();
+  std::vector<ChannelPtr> channels(snapshot->tv);
+  channels.insert(channels.end(), snapshot->radio.begin(), snapshot->radio.end());
+  return channels;
+}
+
+std::shared_ptr<const CChannelRegistry::Snapshot> CChannelRegistry::Get() const
+{
+  return std::atomic_load(&m_snapshot);
+}
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "channel.h"
+
+#include <kodi/AddonBase.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief The known TV and radio channels, indexed for lookups
+ *
+ * Lookups work on an immutable snapshot that is replaced as a whole when a channel list is
+ * refreshed, so they never block and channels stay valid while a caller uses them.
+ */
+class ATTR_DLL_LOCAL CChannelRegistry
+{
+public:
+  using ChannelPtr = std::shared_ptr<const cChannel>;
+
+  CChannelRegistry();
+
+  /**
+   * \brief Replace all channels of the given type
+   */
+  void Replace(CArgusTV::ChannelType type, const std::vector<ChannelPtr>& channels);
+
+  /**
+   * \brief Find a channel by the unique id it has in Kodi (the ARGUS TV channel id)
+   */
+  ChannelPtr FindById(int id) const;
+
+  /**
+   * \brief Find all channels that get their guide from the given guide channel
+   */
+  std::vector<ChannelPtr> FindByGuideChannelId(const std::string& guideChannelId) const;
+
+  /**
+   * \brief Get all TV channels followed by all radio channels
+   */
+  std::vector<ChannelPtr> All() const;
+
+private:
+  struct Snapshot
+  {
+    std::vector<ChannelPtr> tv;
+    std::vector<ChannelPtr> radio;
+    std::unordered_map<int, ChannelPtr> byId;
+    std::unordered_map<std::string, std::vector<ChannelPtr>> byGuideChannelId;
+  };
+
+  std::shared_ptr<const Snapshot> Get() const;
+
+  std::shared_ptr<const Snapshot> m_snapshot;
+  std::mutex m_updateMutex;
+};
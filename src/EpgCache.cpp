@@ -0,0 +1,444 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "EpgCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <kodi/Filesystem.h>
+#include <unordered_set>
+
+namespace
+{
+// File layout, all numbers in host byte order:
+//   "ATVE", version, range count, ranges (start, end, fetched),
+//   program count, programs (start, end, id, title, subtitle, description, genre)
+// Strings are stored as their length followed by the bytes.
+const char EPGCACHE_MAGIC[4] = {'A', 'T', 'V', 'E'};
+const uint32_t EPGCACHE_VERSION = 1;
+
+void PutUInt32(std::string& out, uint32_t value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutInt64(std::string& out, int64_t value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& out, const std::string& value)
+{
+  PutUInt32(out, static_cast<uint32_t>(value.size()));
+  out.append(value);
+}
+
+class BinaryReader
+{
+public:
+  explicit BinaryReader(const std::string& data) : m_data(data) {}
+
+  bool GetUInt32(uint32_t& value) { return Get(&value, sizeof(value)); }
+
+  bool GetInt64(int64_t& value) { return Get(&value, sizeof(value)); }
+
+  bool GetString(std::string& value)
+  {
+    uint32_t length;
+    if (!GetUInt32(length) || length > m_data.size() - m_pos)
+      return false;
+    value.assign(m_data, m_pos, length);
+    m_pos += length;
+    return true;
+  }
+
+  bool GetMagic()
+  {
+    char magic[sizeof(EPGCACHE_MAGIC)];
+    return Get(magic, sizeof(magic)) && memcmp(magic, EPGCACHE_MAGIC, sizeof(magic)) == 0;
+  }
+
+private:
+  bool Get(void* value, size_t size)
+  {
+    if (size > m_data.size() - m_pos)
+      return false;
+    memcpy(value, m_data.data() + m_pos, size);
+    m_pos += size;
+    return true;
+  }
+
+  const std::string& m_data;
+  size_t m_pos = 0;
+};
+} // unnamed namespace
+
+void CEpgCache::Initialize(const std::string& directory)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_directory = directory;
+  m_channels.clear();
+  if (!kodi::vfs::DirectoryExists(m_directory) && !kodi::vfs::CreateDirectory(m_directory))
+    kodi::Log(ADDON_LOG_ERROR, "Unable to create the EPG cache directory %s", m_directory.c_str());
+}
+
+void CEpgCache::SetMaxAge(time_t maxAge)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxAge = maxAge;
+}
+
+std::vector<std::pair<time_t, time_t>> CEpgCache::GetMissingRanges(
+    const std::string& guideChannelId, time_t start, time_t end)
+{
+  std::vector<std::pair<time_t, time_t>> missing;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ChannelData* channel = GetChannel(lock, guideChannelId);
+  if (!channel)
+  {
+    missing.emplace_back(start, end);
+    return missing;
+  }
+  Prune(*channel, time(nullptr));
+
+  time_t covered = start;
+  for (const Range& range : channel->ranges)
+  {
+    if (range.start >= end)
+      break;
+    if (range.end <= covered)
+      continue;
+    if (range.start > covered)
+      missing.emplace_back(covered, range.start);
+    covered = range.end;
+  }
+  if (covered < end)
+    missing.emplace_back(covered, end);
+
+  return missing;
+}
+
+uint64_t CEpgCache::Generation()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_generation;
+}
+
+void CEpgCache::Store(const std::string& guideChannelId,
+                      time_t start,
+                      time_t end,
+                      const std::vector<cEpg>& programs,
+                      uint64_t generation)
+{
+  if (programs.empty())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (IsInvalidated(guideChannelId, generation))
+    return;
+  ChannelData* loaded = GetChannel(lock, guideChannelId);
+  if (!loaded || IsInvalidated(guideChannelId, generation))
+    return;
+  ChannelData& channel = *loaded;
+  time_t now = time(nullptr);
+
+  // Cut the new range out of the existing ones and insert it
+  std::vector<Range> ranges;
+  for (const Range& range : channel.ranges)
+  {
+    if (range.end <= start || range.start >= end)
+    {
+      ranges.push_back(range);
+      continue;
+    }
+    if (range.start < start)
+      ranges.push_back({range.start, start, range.fetched});
+    if (range.end > end)
+      ranges.push_back({end, range.end, range.fetched});
+  }
+  ranges.push_back({start, end, now});
+  std::sort(ranges.begin(), ranges.end(),
+            [](const Range& a, const Range& b) { return a.start < b.start; });
+
+  // Merge adjacent ranges, the merged range is as old as its oldest part
+  channel.ranges.clear();
+  for (const Range& range : ranges)
+  {
+    if (!channel.ranges.empty() && channel.ranges.back().end == range.start)
+    {
+      channel.ranges.back().end = range.end;
+      channel.ranges.back().fetched = std::min(channel.ranges.back().fetched, range.fetched);
+    }
+    else
+    {
+      channel.ranges.push_back(range);
+    }
+  }
+
+  // The server returns every program overlapping the range, so those replace the cached ones
+  channel.programs.erase(std::remove_if(channel.programs.begin(), channel.programs.end(),
+                                        [start, end](const cEpg& program) {
+                                          return program.StartTime() < end &&
+                                                 program.EndTime() > start;
+                                        }),
+                         channel.programs.end());
+  channel.programs.insert(channel.programs.end(), programs.begin(), programs.end());
+  std::stable_sort(channel.programs.begin(), channel.programs.end(),
+                   [](const cEpg& a, const cEpg& b) { return a.StartTime() < b.StartTime(); });
+  std::unordered_set<std::string> seen;
+  channel.programs.erase(std::remove_if(channel.programs.begin(), channel.programs.end(),
+                                        [&seen](const cEpg& program) {
+                                          return !seen.insert(program.UniqueId()).second;
+                                        }),
+                         channel.programs.end());
+
+  Prune(channel, now);
+  if (m_directory.empty())
+    return;
+
+  // Write the file from a copy, so that other channels and lookups don't wait for the disk
+  std::string data = Serialize(channel);
+  uint64_t version = ++channel.version;
+  lock.unlock();
+  Save(guideChannelId, data, version, generation);
+}
+
+std::vector<cEpg> CEpgCache::GetPrograms(const std::string& guideChannelId,
+                                         time_t start,
+                                         time_t end)
+{
+  std::vector<cEpg> programs;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ChannelData* channel = GetChannel(lock, guideChannelId);
+  if (!channel)
+    return programs;
+
+  for (const cEpg& program : channel->programs)
+  {
+    if (program.StartTime() >= end)
+      break;
+    if (program.EndTime() > start)
+      programs.push_back(program);
+  }
+  return programs;
+}
+
+void CEpgCache::Invalidate()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_invalidatedAll = ++m_generation;
+  m_invalidated.clear();
+  m_channels.clear();
+  if (m_directory.empty())
+    return;
+
+  std::vector<kodi::vfs::CDirEntry> items;
+  if (!kodi::vfs::GetDirectory(m_directory, ".epg|.tmp", items))
+    return;
+  for (const kodi::vfs::CDirEntry& item : items)
+  {
+    if (!item.IsFolder() && !kodi::vfs::DeleteFile(item.Path()))
+      kodi::Log(ADDON_LOG_ERROR, "Unable to delete the EPG cache file %s", item.Path().c_str());
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "Dropped the cached guide data of %zu channels", items.size());
+}
+
+void CEpgCache::Invalidate(const std::string& guideChannelId)
+{
+  std::string fileName;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_invalidated[guideChannelId] = ++m_generation;
+    m_channels.erase(guideChannelId);
+    if (m_directory.empty())
+      return;
+    fileName = FileName(guideChannelId);
+  }
+
+  // A file written meanwhile holds data fetched after the invalidation, losing it costs a fetch
+  if (kodi::vfs::FileExists(fileName, false) && !kodi::vfs::DeleteFile(fileName))
+    kodi::Log(ADDON_LOG_ERROR, "Unable to delete the EPG cache file %s", fileName.c_str());
+  kodi::Log(ADDON_LOG_DEBUG, "Dropped the cached guide data of guide channel %s",
+            guideChannelId.c_str());
+}
+
+CEpgCache::ChannelData* CEpgCache::GetChannel(std::unique_lock<std::mutex>& lock,
+                                              const std::string& guideChannelId)
+{
+  auto it = m_channels.find(guideChannelId);
+  if (it != m_channels.end())
+    return &it->second;
+
+  // Read the file without the lock, lookups of other channels don't wait for the disk
+  uint64_t generation = m_generation;
+  std::string fileName = m_directory.empty() ? std::string() : FileName(guideChannelId);
+  lock.unlock();
+  ChannelData channel;
+  if (!Load(guideChannelId, fileName, channel))
+    channel = ChannelData();
+  lock.lock();
+
+  // The file is outdated when the cache was invalidated meanwhile. Another caller may have
+  // loaded the channel as well, the data that is already in use wins.
+  if (IsInvalidated(guideChannelId, generation))
+    return nullptr;
+  return &m_channels.emplace(guideChannelId, std::move(channel)).first->second;
+}
+
+bool CEpgCache::IsInvalidated(const std::string& guideChannelId, uint64_t generation) const
+{
+  // Called with m_mutex held, for data fetched or loaded in the given generation
+  if (generation < m_invalidatedAll)
+    return true;
+  auto it = m_invalidated.find(guideChannelId);
+  return it != m_invalidated.end() && generation < it->second;
+}
+
+void CEpgCache::Prune(ChannelData& channel, time_t now) const
+{
+  channel.ranges.erase(std::remove_if(channel.ranges.begin(), channel.ranges.end(),
+                                      [this, now](const Range& range) {
+                                        return range.fetched + m_maxAge <= now ||
+                                               range.end < now - EPGCACHE_HISTORY_SECONDS;
+                                      }),
+                       channel.ranges.end());
+
+  // Programs outside the remaining ranges can never be served
+  const std::vector<Range>& ranges = channel.ranges;
+  auto isCovered = [&ranges](const cEpg& program) {
+    for (const Range& range : ranges)
+    {
+      if (program.StartTime() < range.end && program.EndTime() > range.start)
+        return true;
+    }
+    return false;
+  };
+  channel.programs.erase(std::remove_if(channel.programs.begin(), channel.programs.end(),
+                                        [&isCovered](const cEpg& program) {
+                                          return !isCovered(program);
+                                        }),
+                         channel.programs.end());
+}
+
+std::string CEpgCache::FileName(const std::string& guideChannelId) const
+{
+  std::string name = guideChannelId;
+  for (char& c : name)
+  {
+    if (!isalnum(static_cast<unsigned char>(c)) && c != '-')
+      c = '_';
+  }
+  return m_directory + name + ".epg";
+}
+
+bool CEpgCache::Load(const std::string& guideChannelId,
+                     const std::string& fileName,
+                     ChannelData& channel) const
+{
+  kodi::vfs::CFile file;
+  if (fileName.empty() || !file.OpenFile(fileName))
+    return false;
+
+  int64_t length = file.GetLength();
+  if (length <= 0)
+    return false;
+  std::string data(static_cast<size_t>(length), '\0');
+  size_t used = 0;
+  while (used < data.size())
+  {
+    ssize_t bytesRead = file.Read(&data[used], data.size() - used);
+    if (bytesRead <= 0)
+      return false;
+    used += static_cast<size_t>(bytesRead);
+  }
+
+  BinaryReader reader(data);
+  uint32_t version;
+  uint32_t count;
+  if (!reader.GetMagic() || !reader.GetUInt32(version) || version != EPGCACHE_VERSION ||
+      !reader.GetUInt32(count))
+    return false;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    int64_t start, end, fetched;
+    if (!reader.GetInt64(start) || !reader.GetInt64(end) || !reader.GetInt64(fetched))
+      return false;
+    channel.ranges.push_back(
+        {static_cast<time_t>(start), static_cast<time_t>(end), static_cast<time_t>(fetched)});
+  }
+
+  if (!reader.GetUInt32(count))
+    return false;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    int64_t start, end;
+    std::string id, title, subtitle, description, genre;
+    if (!reader.GetInt64(start) || !reader.GetInt64(end) || !reader.GetString(id) ||
+        !reader.GetString(title) || !reader.GetString(subtitle) ||
+        !reader.GetString(description) || !reader.GetString(genre))
+      return false;
+    channel.programs.emplace_back(id, title, subtitle, description, genre,
+                                  static_cast<time_t>(start), static_cast<time_t>(end));
+  }
+
+  kodi::Log(ADDON_LOG_DEBUG, "Loaded %u cached guide programs for guide channel %s", count,
+            guideChannelId.c_str());
+  return true;
+}
+
+std::string CEpgCache::Serialize(const ChannelData& channel) const
+{
+  std::string data(EPGCACHE_MAGIC, sizeof(EPGCACHE_MAGIC));
+  PutUInt32(data, EPGCACHE_VERSION);
+  PutUInt32(data, static_cast<uint32_t>(channel.ranges.size()));
+  for (const Range& range : channel.ranges)
+  {
+    PutInt64(data, range.start);
+    PutInt64(data, range.end);
+    PutInt64(data, range.fetched);
+  }
+  PutUInt32(data, static_cast<uint32_t>(channel.programs.size()));
+  for (const cEpg& program : channel.programs)
+  {
+    PutInt64(data, program.StartTime());
+    PutInt64(data, program.EndTime());
+    PutString(data, program.UniqueId());
+    PutString(data, program.Title());
+    PutString(data, program.Subtitle());
+    PutString(data, program.Description());
+    PutString(data, program.Genre());
+  }
+  return data;
+}
+
+void CEpgCache::Save(const std::string& guideChannelId,
+                     const std::string& data,
+                     uint64_t version,
+                     uint64_t generation)
+{
+  // Write a temporary file first, so that a crash never leaves a partial cache file behind
+  std::string fileName = FileName(guideChannelId);
+  std::string tmpFileName = fileName + "." + std::to_string(version) + ".tmp";
+  kodi::vfs::CFile file;
+  bool written = file.OpenFileForWrite(tmpFileName, true) &&
+                 file.Write(data.data(), data.size()) == static_cast<ssize_t>(data.size());
+  file.Close();
+
+  // Only the newest data of a channel may replace its file, and none after an invalidation
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_channels.find(guideChannelId);
+  bool current = !IsInvalidated(guideChannelId, generation) && it != m_channels.end() &&
+                 it->second.version == version;
+  if (written && current && kodi::vfs::RenameFile(tmpFileName, fileName))
+    return;
+
+  kodi::vfs::DeleteFile(tmpFileName);
+  if (current)
+    kodi::Log(ADDON_LOG_ERROR, "Unable to write the EPG cache file for guide channel %s",
+              guideChannelId.c_str());
+}
@@ -0,0 +1,124 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "epg.h"
+
+#include <cstdint>
+#include <ctime>
+#include <kodi/AddonBase.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Guide data that ended longer ago than this is dropped from the cache
+#define EPGCACHE_HISTORY_SECONDS (2 * 24 * 60 * 60)
+
+/**
+ * \brief On-disk cache of guide programs per guide channel
+ *
+ * For every guide channel the cache remembers which time ranges were fetched from the server
+ * and when, together with the programs in them. Ranges older than the maximum age count as
+ * not covered, so only the missing or stale parts of a requested window need to be fetched.
+ * Each channel is stored in its own binary file and loaded on first use.
+ */
+class ATTR_DLL_LOCAL CEpgCache
+{
+public:
+  CEpgCache() = default;
+
+  /**
+   * \brief Set the directory holding the cache files and create it when needed
+   */
+  void Initialize(const std::string& directory);
+
+  /**
+   * \brief Set how long fetched guide data stays valid
+   * \param maxAge Maximum age in seconds
+   */
+  void SetMaxAge(time_t maxAge);
+
+  /**
+   * \brief Get the parts of [start, end) that are not covered by valid cached guide data
+   */
+  std::vector<std::pair<time_t, time_t>> GetMissingRanges(const std::string& guideChannelId,
+                                                          time_t start,
+                                                          time_t end);
+
+  /**
+   * \brief The current generation of the cache, taken before fetching data to store
+   */
+  uint64_t Generation();
+
+  /**
+   * \brief Replace the cached guide data of [start, end) with the programs fetched for it
+   *
+   * An empty result is not cached, it may be a server that has not imported its guide yet
+   * rather than a gap in the guide, so the range is asked for again next time.
+   * \param generation The generation the fetch started in, data fetched before the cache was
+   *                   invalidated is dropped
+   */
+  void Store(const std::string& guideChannelId,
+             time_t start,
+             time_t end,
+             const std::vector<cEpg>& programs,
+             uint64_t generation);
+
+  /**
+   * \brief Get the cached programs overlapping [start, end), ordered by start time
+   */
+  std::vector<cEpg> GetPrograms(const std::string& guideChannelId, time_t start, time_t end);
+
+  /**
+   * \brief Drop the cached guide data of all channels, in memory and on disk
+   */
+  void Invalidate();
+
+  /**
+   * \brief Drop the cached guide data of one guide channel, in memory and on disk
+   */
+  void Invalidate(const std::string& guideChannelId);
+
+private:
+  struct Range
+  {
+    time_t start;
+    time_t end;
+    time_t fetched;
+  };
+
+  struct ChannelData
+  {
+    std::vector<Range> ranges; // ordered by start, not overlapping
+    std::vector<cEpg> programs; // ordered by start time
+    uint64_t version = 0; // of the latest data handed out to be written to disk
+  };
+
+  ChannelData* GetChannel(std::unique_lock<std::mutex>& lock, const std::string& guideChannelId);
+  bool IsInvalidated(const std::string& guideChannelId, uint64_t generation) const;
+  void Prune(ChannelData& channel, time_t now) const;
+  std::string FileName(const std::string& guideChannelId) const;
+  bool Load(const std::string& guideChannelId,
+            const std::string& fileName,
+            ChannelData& channel) const;
+  std::string Serialize(const ChannelData& channel) const;
+  void Save(const std::string& guideChannelId,
+            const std::string& data,
+            uint64_t version,
+            uint64_t generation);
+
+  std::mutex m_mutex;
+  std::string m_directory;
+  time_t m_maxAge = 0;
+  uint64_t m_generation = 0; // increased by every invalidation
+  uint64_t m_invalidatedAll = 0; // generation of the last invalidation of all channels
+  std::unordered_map<std::string, uint64_t> m_invalidated; // of single channels since then
+  std::unordered_map<std::string, ChannelData> m_channels;
+};
@@ -0,0 +1,189 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "EpgPrefetcher.h"
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+CEpgPrefetcher::~CEpgPrefetcher()
+{
+  Stop();
+}
+
+void CEpgPrefetcher::Start(const std::vector<std::string>& guideChannelIds,
+                           const std::string& handled,
+                           time_t start,
+                           time_t end,
+                           int maxWorkers,
+                           const FetchFunction& fetch)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_busy || Covers(start, end))
+    return;
+
+  auto now = std::chrono::steady_clock::now();
+  if (m_roundStarted != std::chrono::steady_clock::time_point() &&
+      now - m_roundStarted < std::chrono::seconds(EPGPREFETCH_INTERVAL))
+    return;
+
+  // The previous round has finished, its thread only needs to be reaped
+  if (m_thread.joinable())
+    m_thread.join();
+
+  // Channels sharing a guide channel are fetched once, in the order Kodi asks for them
+  m_entries.clear();
+  std::unordered_set<std::string> seen;
+  std::vector<std::string> channels;
+  channels.reserve(guideChannelIds.size());
+  for (const std::string& guideChannelId : guideChannelIds)
+  {
+    if (!guideChannelId.empty() && guideChannelId != handled &&
+        seen.insert(guideChannelId).second)
+    {
+      m_entries[guideChannelId] = Entry();
+      channels.push_back(guideChannelId);
+    }
+  }
+
+  m_busy = true;
+  m_start = start;
+  m_end = end + EPGPREFETCH_MARGIN;
+  m_roundStarted = now;
+  m_thread = std::thread(&CEpgPrefetcher::Process, this, std::move(channels), m_round.load(),
+                         m_start, m_end, maxWorkers, fetch);
+}
+
+void CEpgPrefetcher::Process(std::vector<std::string> guideChannelIds,
+                             uint64_t round,
+                             time_t start,
+                             time_t end,
+                             int maxWorkers,
+                             FetchFunction fetch)
+{
+  kodi::Log(ADDON_LOG_DEBUG, "Prefetching the guide data of %zu channels", guideChannelIds.size());
+  auto startTime = std::chrono::steady_clock::now();
+
+  CWorkerPool::Run(guideChannelIds.size(), maxWorkers, [&](size_t index) {
+    std::vector<cEpg> programs;
+    bool fetched =
+        !m_stop && round == m_round && fetch(guideChannelIds[index], start, end, programs);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(guideChannelIds[index]);
+    if (it != m_entries.end())
+    {
+      it->second.state = fetched ? EntryState::Ready : EntryState::Failed;
+      it->second.programs = std::move(programs);
+    }
+    m_condition.notify_all();
+  });
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_busy = false;
+  m_condition.notify_all();
+  auto totalTime = std::chrono::steady_clock::now() - startTime;
+  kodi::Log(ADDON_LOG_INFO, "Prefetching the guide data of %zu channels took %d milliseconds.",
+            guideChannelIds.size(),
+            static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(totalTime).count()));
+}
+
+bool CEpgPrefetcher::Take(const std::string& guideChannelId,
+                          time_t start,
+                          time_t end,
+                          std::vector<cEpg>& programs)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!Covers(start, end) || m_entries.find(guideChannelId) == m_entries.end())
+  {
+    m_misses++;
+    return false;
+  }
+
+  // The channel is part of the current round, wait for its turn to finish
+  m_condition.wait(lock, [this, &guideChannelId] {
+    auto it = m_entries.find(guideChannelId);
+    return it == m_entries.end() || it->second.state != EntryState::Pending;
+  });
+
+  auto it = m_entries.find(guideChannelId);
+  if (it == m_entries.end() || it->second.state == EntryState::Failed)
+  {
+    if (it != m_entries.end())
+      m_entries.erase(it);
+    m_misses++;
+    return false;
+  }
+
+  programs = std::move(it->second.programs);
+  programs.erase(std::remove_if(programs.begin(), programs.end(),
+                                [start, end](const cEpg& program) {
+                                  return program.StartTime() >= end || program.EndTime() <= start;
+                                }),
+                 programs.end());
+  m_entries.erase(it);
+  m_hits++;
+
+  bool roundConsumed = m_entries.empty();
+  lock.unlock();
+  if (roundConsumed)
+    LogStatistics();
+  return true;
+}
+
+void CEpgPrefetcher::Stop()
+{
+  m_stop = true;
+  if (m_thread.joinable())
+    m_thread.join();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_busy = false;
+  m_start = 0;
+  m_end = 0;
+  m_roundStarted = std::chrono::steady_clock::time_point();
+  m_condition.notify_all();
+  m_stop = false;
+}
+
+void CEpgPrefetcher::Discard()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_round++;
+  m_entries.clear();
+  m_start = 0;
+  m_end = 0;
+  m_roundStarted = std::chrono::steady_clock::time_point();
+  m_condition.notify_all();
+}
+
+void CEpgPrefetcher::Discard(const std::string& guideChannelId)
+{
+  // A worker that is still fetching the channel finds no entry for its result
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.erase(guideChannelId);
+  m_condition.notify_all();
+}
+
+void CEpgPrefetcher::LogStatistics()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t total = m_hits + m_misses;
+  kodi::Log(ADDON_LOG_INFO,
+            "EPG prefetch: %llu of %llu requests served from memory (%llu%% hits, %llu misses).",
+            static_cast<unsigned long long>(m_hits), static_cast<unsigned long long>(total),
+            static_cast<unsigned long long>(total > 0 ? m_hits * 100 / total : 0),
+            static_cast<unsigned long long>(m_misses));
+}
+
+bool CEpgPrefetcher::Covers(time_t start, time_t end) const
+{
+  return m_end > 0 && m_start <= start && end <= m_end;
+}
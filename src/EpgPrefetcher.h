@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "epg.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <kodi/AddonBase.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Guide data is prefetched up to this many seconds beyond the requested window
+#define EPGPREFETCH_MARGIN (60 * 60)
+// Minimum number of seconds between the starts of two prefetch rounds
+#define EPGPREFETCH_INTERVAL (5 * 60)
+
+/**
+ * \brief Fetches the guide data of many channels in the background
+ *
+ * Kodi requests the guide channel by channel. The first request of an update starts a
+ * prefetch round that fetches the guide data of all other channels on a bounded number of
+ * worker threads, so that the following requests can be answered from memory.
+ */
+class ATTR_DLL_LOCAL CEpgPrefetcher
+{
+public:
+  using FetchFunction = std::function<bool(
+      const std::string& guideChannelId, time_t start, time_t end, std::vector<cEpg>& programs)>;
+
+  CEpgPrefetcher() = default;
+  ~CEpgPrefetcher();
+
+  /**
+   * \brief Start a prefetch round for [start, end) unless the current round covers it
+   * \param guideChannelIds The guide channels to fetch, in the order they are fetched
+   * \param handled         The guide channel the caller fetches itself, left out of the round
+   * \param maxWorkers      Upper bound on the number of concurrent requests
+   * \param fetch           Fetches the programs of one guide channel, called from the workers
+   */
+  void Start(const std::vector<std::string>& guideChannelIds,
+             const std::string& handled,
+             time_t start,
+             time_t end,
+             int maxWorkers,
+             const FetchFunction& fetch);
+
+  /**
+   * \brief Hand out the prefetched programs of a guide channel that overlap [start, end)
+   *
+   * Waits when the channel is still being fetched by the current round.
+   * \return false on a miss, the caller has to fetch the programs itself
+   */
+  bool Take(const std::string& guideChannelId,
+            time_t start,
+            time_t end,
+            std::vector<cEpg>& programs);
+
+  /**
+   * \brief Abort the current round and drop all prefetched data
+   */
+  void Stop();
+
+  /**
+   * \brief Drop all prefetched data, a running round skips its remaining channels
+   */
+  void Discard();
+
+  /**
+   * \brief Drop the prefetched data of one guide channel, also when it is still being fetched
+   */
+  void Discard(const std::string& guideChannelId);
+
+  /**
+   * \brief Log how many requests were answered from prefetched data
+   */
+  void LogStatistics();
+
+private:
+  enum class EntryState
+  {
+    Pending,
+    Ready,
+    Failed
+  };
+
+  struct Entry
+  {
+    EntryState state = EntryState::Pending;
+    std::vector<cEpg> programs;
+  };
+
+  void Process(std::vector<std::string> guideChannelIds,
+               uint64_t round,
+               time_t start,
+               time_t end,
+               int maxWorkers,
+               FetchFunction fetch);
+  bool Covers(time_t start, time_t end) const;
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::thread m_thread;
+  std::atomic<bool> m_stop = {false};
+  std::atomic<uint64_t> m_round = {0};
+  bool m_busy = false;
+  time_t m_start = 0;
+  time_t m_end = 0;
+  std::chrono::steady_clock::time_point m_roundStarted;
+  std::unordered_map<std::string, Entry> m_entries;
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+};
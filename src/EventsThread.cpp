@@ -11,7 +11,13 @@
 #include "argustvrpc.h"
 #include "pvrclient-argustv.h"
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 #include <kodi/General.h>
+#include <set>
+#include <string>
+#include <vector>
 
 CEventsThread::CEventsThread(cPVRClientArgusTV& instance) : m_instance(instance)
 {
@@ -43,9 +49,14 @@ void CEventsThread::StopThread()
   kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: stop");
   if (m_running)
   {
-    m_running = false;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    m_condition.notify_all();
     if (m_thread.joinable())
       m_thread.join();
+    LogStatistics();
   }
 }
 
@@ -68,14 +79,29 @@ void CEventsThread::Connect()
   }
 }
 
+void CEventsThread::NotifyActivity()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_activity = true;
+  }
+  m_condition.notify_all();
+}
+
 void CEventsThread::Process()
 {
   kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: thread started");
+  int interval = EVENTS_POLL_INTERVAL_MIN;
   while (m_running && m_subscribed)
   {
     // Get service events
+    auto pollStart = std::chrono::steady_clock::now();
     Json::Value response;
+    unsigned int eventCount = 0;
     int retval = m_instance.GetRPC().GetServiceEvents(m_monitorId, response);
+    auto pollTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - pollStart)
+                        .count();
     if (retval >= 0)
     {
       if (response["Expired"].asBool())
@@ -87,16 +113,40 @@ void CEventsThread::Process()
       {
         // Process service events
         Json::Value events = response["Events"];
-        if (events.size() > 0u)
+        eventCount = events.size();
+        if (eventCount > 0u)
           HandleEvents(events);
       }
     }
+    m_polls++;
+    m_events += eventCount;
+
+    // A server that held the request until it had events can be asked again right away. A slow
+    // answer without events may just be a slow server, that one gets the normal pause.
+    bool longPoll = retval >= 0 && eventCount > 0u && pollTime >= EVENTS_LONGPOLL_THRESHOLD;
+    if (longPoll != m_longPoll)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: the server %s requests open",
+                longPoll ? "holds" : "no longer holds");
+      m_longPoll = longPoll;
+    }
+
+    // Events tend to come in bursts, look again soon after some and back off while it is quiet
+    if (eventCount > 0u)
+      interval = EVENTS_POLL_INTERVAL_MIN;
+    else
+      interval = std::min(interval * 2, EVENTS_POLL_INTERVAL_MAX);
 
-    for (int i = 0; i < 100; i++)
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto wakeUp =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(longPoll ? 0 : interval);
+    while (m_running &&
+           m_condition.wait_until(lock, wakeUp, [this] { return !m_running || m_activity; }))
     {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      if (!m_running)
-        break;
+      m_activity = false;
+      interval = EVENTS_POLL_INTERVAL_MIN;
+      wakeUp = std::min(wakeUp, std::chrono::steady_clock::now() +
+                                    std::chrono::milliseconds(EVENTS_POLL_INTERVAL_MIN));
     }
   }
   kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: thread stopped");
@@ -108,22 +158,85 @@ void CEventsThread::HandleEvents(Json::Value events)
   int size = events.size();
   bool mustUpdateTimers = false;
   bool mustUpdateRecordings = false;
+  bool mustUpdateChannels = false;
+  bool mustUpdateGuide = false;
+  std::set<std::string> changedGuideChannels;
   // Aggregate events
   for (int i = 0; i < size; i++)
   {
     Json::Value event = events[i];
     std::string eventName = event["Name"].asString();
     kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: ARGUS TV reports event %s", eventName.c_str());
-    if (eventName == "UpcomingRecordingsChanged")
+
+    // The latency includes any difference between the clocks of the server and this client
+    int offset;
+    time_t eventTime = CArgusTV::WCFDateToTimeT(event["Time"], offset);
+    time_t now = time(nullptr);
+    if (eventTime > 0 && now >= eventTime)
+    {
+      uint64_t latency = static_cast<uint64_t>(now - eventTime);
+      m_latencyTotal += latency;
+      m_latencyCount++;
+      m_latencyMax = std::max(m_latencyMax, latency);
+    }
+
+    if (eventName == "UpcomingRecordingsChanged" || eventName == "ScheduleChanged" ||
+        eventName == "ActiveRecordingsChanged")
     {
       kodi::Log(ADDON_LOG_DEBUG, "Timers changed");
       mustUpdateTimers = true;
     }
     else if (eventName == "RecordingStarted" || eventName == "RecordingEnded")
     {
-      kodi::Log(ADDON_LOG_DEBUG, "Recordings changed");
+      // The first argument is the recording, only its title needs to be fetched again
+      const Json::Value& arguments = event["Arguments"];
+      std::string title;
+      if (arguments.isArray() && arguments.size() > 0u && arguments[0u].isObject())
+        title = arguments[0u]["Title"].asString();
+      kodi::Log(ADDON_LOG_DEBUG, "Recordings changed (title \"%s\")", title.c_str());
+      m_instance.RecordingChanged(title);
       mustUpdateRecordings = true;
     }
+    else if (eventName == "NewGuideData")
+    {
+      // The arguments name the guide channels that got new data, by id or as guide channel
+      // objects. Without any the whole guide may have changed.
+      const Json::Value& arguments = event["Arguments"];
+      size_t named = 0;
+      if (arguments.isArray())
+      {
+        for (const Json::Value& argument : arguments)
+        {
+          std::string guideChannelId;
+          if (argument.isString())
+            guideChannelId = argument.asString();
+          else if (argument.isObject())
+            guideChannelId = argument["GuideChannelId"].asString();
+          if (!guideChannelId.empty())
+          {
+            changedGuideChannels.insert(guideChannelId);
+            named++;
+          }
+        }
+      }
+      kodi::Log(ADDON_LOG_DEBUG, "Guide data changed (%zu guide channels named)", named);
+      if (named == 0)
+        mustUpdateGuide = true;
+    }
+    else if (eventName == "ConfigurationChanged")
+    {
+      // Channels and channel groups are part of the server configuration
+      kodi::Log(ADDON_LOG_DEBUG, "Configuration changed");
+      mustUpdateChannels = true;
+    }
+    else if (eventName == "SystemResumed")
+    {
+      // Events may have been lost while the server was in standby
+      kodi::Log(ADDON_LOG_DEBUG, "Server resumed");
+      m_instance.RecordingChanged("");
+      mustUpdateRecordings = true;
+      mustUpdateTimers = true;
+    }
   }
   // Handle aggregated events
   if (mustUpdateTimers)
@@ -136,4 +249,35 @@ void CEventsThread::HandleEvents(Json::Value events)
     kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: Recordings update triggered");
     m_instance.TriggerRecordingUpdate();
   }
+  if (mustUpdateChannels)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: Channels update triggered");
+    m_instance.ChannelsChanged();
+  }
+  if (mustUpdateGuide)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: Guide update triggered");
+    m_instance.GuideChanged({});
+  }
+  else if (!changedGuideChannels.empty())
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "CEventsThread:: Guide update of %zu guide channels triggered",
+              changedGuideChannels.size());
+    m_instance.GuideChanged(
+        std::vector<std::string>(changedGuideChannels.begin(), changedGuideChannels.end()));
+  }
+}
+
+void CEventsThread::LogStatistics()
+{
+  if (m_polls == 0)
+    return;
+
+  kodi::Log(ADDON_LOG_INFO,
+            "Service events: %llu polls, %llu events (%.2f per poll), notified after %llu s on "
+            "average and %llu s at most.",
+            static_cast<unsigned long long>(m_polls), static_cast<unsigned long long>(m_events),
+            static_cast<double>(m_events) / m_polls,
+            static_cast<unsigned long long>(m_latencyCount > 0 ? m_latencyTotal / m_latencyCount : 0),
+            static_cast<unsigned long long>(m_latencyMax));
 }
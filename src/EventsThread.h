@@ -9,10 +9,20 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <json/json.h>
 #include <kodi/AddonBase.h>
+#include <mutex>
 #include <thread>
 
+// Bounds in msec of the pause between two polls, it doubles after every poll without events
+#define EVENTS_POLL_INTERVAL_MIN 1000
+#define EVENTS_POLL_INTERVAL_MAX 10000
+// A poll that takes at least this many msec and returns events means the server held the request
+// until it had events
+#define EVENTS_LONGPOLL_THRESHOLD 3000
+
 class cPVRClientArgusTV;
 
 class ATTR_DLL_LOCAL CEventsThread
@@ -24,15 +34,31 @@ public:
 
   void StartThread();
   void StopThread();
+  bool IsSubscribed() const { return m_subscribed; }
+
+  /**
+   * \brief Poll soon, the user did something that makes the server send events
+   */
+  void NotifyActivity();
 
 private:
   void Process();
 
   void HandleEvents(Json::Value events);
+  void LogStatistics();
 
-  bool m_subscribed = false;
+  std::atomic<bool> m_subscribed = {false};
   std::string m_monitorId;
   cPVRClientArgusTV& m_instance;
   std::atomic<bool> m_running = {false};
   std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_activity = false;
+  bool m_longPoll = false;
+  uint64_t m_polls = 0;
+  uint64_t m_events = 0;
+  uint64_t m_latencyTotal = 0; // seconds from the event on the server until it was handled
+  uint64_t m_latencyCount = 0;
+  uint64_t m_latencyMax = 0;
 };
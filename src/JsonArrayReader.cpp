@@ -0,0 +1,142 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "JsonArrayReader.h"
+
+namespace
+{
+inline bool IsWhitespace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+} // unnamed namespace
+
+CJsonArrayReader::CJsonArrayReader(const ElementCallback& onElement) : m_onElement(onElement)
+{
+  Json::CharReaderBuilder jsonReaderBuilder;
+  m_reader.reset(jsonReaderBuilder.newCharReader());
+}
+
+bool CJsonArrayReader::Feed(const char* data, size_t length)
+{
+  // Start of the part of the current element that lies within this chunk
+  size_t elementStart = 0;
+
+  for (size_t i = 0; i < length && m_state != State::Error; i++)
+  {
+    char c = data[i];
+    switch (m_state)
+    {
+      case State::BeforeArray:
+        if (c == '[')
+          m_state = State::BeforeFirstElement;
+        else if (!IsWhitespace(c))
+          m_state = State::Error;
+        break;
+
+      case State::BeforeFirstElement:
+        // Only an empty array may end before its first element
+        if (c == ']')
+        {
+          m_state = State::Done;
+          break;
+        }
+        [[fallthrough]];
+
+      case State::BeforeElement:
+        if (IsWhitespace(c))
+          break;
+        if (c == ']')
+        {
+          // a comma without an element after it
+          m_state = State::Error;
+          break;
+        }
+        m_state = State::InElement;
+        elementStart = i;
+        [[fallthrough]];
+
+      case State::InElement:
+        if (m_inString)
+        {
+          if (m_escaped)
+            m_escaped = false;
+          else if (c == '\\')
+            m_escaped = true;
+          else if (c == '"')
+            m_inString = false;
+        }
+        else if (c == '"')
+        {
+          m_inString = true;
+        }
+        else if (c == '{' || c == '[')
+        {
+          m_depth++;
+        }
+        else if ((c == '}' || c == ']') && m_depth > 0)
+        {
+          if (--m_depth == 0)
+          {
+            // end of an object or array element
+            m_element.append(data + elementStart, i + 1 - elementStart);
+            m_state = EmitElement() ? State::AfterElement : State::Error;
+          }
+        }
+        else if (m_depth == 0 && (c == ',' || c == ']'))
+        {
+          // end of a scalar element
+          m_element.append(data + elementStart, i - elementStart);
+          if (!EmitElement())
+            m_state = State::Error;
+          else
+            m_state = c == ',' ? State::BeforeElement : State::Done;
+        }
+        break;
+
+      case State::AfterElement:
+        if (c == ',')
+          m_state = State::BeforeElement;
+        else if (c == ']')
+          m_state = State::Done;
+        else if (!IsWhitespace(c))
+          m_state = State::Error;
+        break;
+
+      case State::Done:
+        if (!IsWhitespace(c))
+          m_state = State::Error;
+        break;
+
+      case State::Error:
+        break;
+    }
+  }
+
+  // Keep the incomplete element for the next chunk
+  if (m_state == State::InElement)
+    m_element.append(data + elementStart, length - elementStart);
+
+  return m_state != State::Error;
+}
+
+bool CJsonArrayReader::EmitElement()
+{
+  Json::Value element;
+  std::string jsonReaderError;
+  if (!m_reader->parse(m_element.c_str(), m_element.c_str() + m_element.size(), &element,
+                       &jsonReaderError))
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "Failed to parse array element %zu: %s", m_count,
+              jsonReaderError.c_str());
+    return false;
+  }
+  m_element.clear();
+  m_count++;
+  m_onElement(element);
+  return true;
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <json/json.h>
+#include <kodi/AddonBase.h>
+#include <memory>
+#include <string>
+
+/**
+ * \brief Incremental reader for a JSON array response
+ *
+ * The response text is fed in arbitrary chunks as it is downloaded. Every time a top level
+ * element of the array is complete it is parsed on its own and handed to the callback, so only
+ * the text of one element is held in memory at any time.
+ */
+class ATTR_DLL_LOCAL CJsonArrayReader
+{
+public:
+  using ElementCallback = std::function<void(const Json::Value&)>;
+
+  explicit CJsonArrayReader(const ElementCallback& onElement);
+
+  /**
+   * \brief Process the next chunk of the response
+   * \return false when the response is not a valid JSON array
+   */
+  bool Feed(const char* data, size_t length);
+
+  /**
+   * \brief Check that the whole array has been read after the last chunk was fed
+   */
+  bool Finish() const { return m_state == State::Done; }
+
+  /**
+   * \brief Number of elements handed to the callback so far
+   */
+  size_t Count() const { return m_count; }
+
+private:
+  enum class State
+  {
+    BeforeArray,
+    BeforeFirstElement,
+    BeforeElement,
+    InElement,
+    AfterElement,
+    Done,
+    Error
+  };
+
+  bool EmitElement();
+
+  ElementCallback m_onElement;
+  std::unique_ptr<Json::CharReader> m_reader;
+  State m_state = State::BeforeArray;
+  std::string m_element;
+  int m_depth = 0;
+  bool m_inString = false;
+  bool m_escaped = false;
+  size_t m_count = 0;
+};
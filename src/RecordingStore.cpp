@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "RecordingStore.h"
+
+#include "WorkerPool.h"
+
+#include <chrono>
+
+CRecordingStore::CRecordingStore() : m_fileNames(std::make_shared<FileNames>())
+{
+}
+
+bool CRecordingStore::Update(const FetchTitlesFunction& fetchTitles,
+                             const FetchRecordingsFunction& fetchRecordings,
+                             int maxWorkers)
+{
+  // An update started while another one runs would fetch the same titles again
+  std::lock_guard<std::mutex> updateLock(m_updateMutex);
+  bool valid;
+  std::set<std::string> changedTitles;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    valid = m_valid;
+    changedTitles.swap(m_changedTitles);
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+  if (!valid)
+  {
+    std::vector<std::string> titles;
+    if (!fetchTitles(titles))
+      return false;
+
+    // Every title gets its own slots, so the workers never share one
+    std::vector<std::vector<cRecording>> recordingsByTitle(titles.size());
+    std::vector<char> fetched(titles.size(), 0);
+    CWorkerPool::Run(titles.size(), maxWorkers, [&](size_t index) {
+      fetched[index] = fetchRecordings(titles[index], recordingsByTitle[index]);
+    });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, std::vector<cRecording>> previous;
+    previous.swap(m_titles);
+    for (size_t index = 0; index < titles.size(); index++)
+    {
+      // A title that failed keeps what was known of it and is fetched again at the next update
+      if (!fetched[index])
+      {
+        m_changedTitles.insert(titles[index]);
+        auto known = previous.find(titles[index]);
+        if (known != previous.end())
+          m_titles.insert(std::move(*known));
+      }
+      else if (!recordingsByTitle[index].empty())
+        m_titles[titles[index]] = std::move(recordingsByTitle[index]);
+    }
+    // Titles reported while the refresh ran stay marked, they may have changed after their fetch
+    m_valid = true;
+    m_generation++;
+    UpdateCount();
+    PublishFileNames();
+    kodi::Log(ADDON_LOG_DEBUG, "Fetched the recordings of all %zu titles in %d milliseconds.",
+              titles.size(),
+              static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - startTime)
+                                   .count()));
+    return true;
+  }
+
+  for (auto it = changedTitles.begin(); it != changedTitles.end();)
+  {
+    std::vector<cRecording> recordings;
+    if (!fetchRecordings(*it, recordings))
+    {
+      // Try the remaining titles again at the next update
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_changedTitles.insert(it, changedTitles.end());
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (recordings.empty())
+      m_titles.erase(*it);
+    else
+      m_titles[*it] = std::move(recordings);
+    m_generation++;
+    UpdateCount();
+    PublishFileNames();
+    kodi::Log(ADDON_LOG_DEBUG, "Fetched the recordings of title \"%s\" again.", it->c_str());
+    it = changedTitles.erase(it);
+  }
+  return true;
+}
+
+void CRecordingStore::Invalidate()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_valid = false;
+  m_changedTitles.clear();
+}
+
+void CRecordingStore::InvalidateIfUnchanged(uint64_t generation, bool keepChanges)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_generation != generation || (keepChanges && (!m_valid || !m_changedTitles.empty())))
+    return;
+  m_valid = false;
+  m_changedTitles.clear();
+}
+
+void CRecordingStore::InvalidateTitle(const std::string& title)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_changedTitles.insert(title);
+}
+
+uint64_t CRecordingStore::ForEach(const RecordingFunction& func) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& title : m_titles)
+  {
+    for (const cRecording& recording : title.second)
+      func(recording, title.second.size());
+  }
+  return m_generation;
+}
+
+size_t CRecordingStore::Count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_count;
+}
+
+void CRecordingStore::UpdateCount()
+{
+  m_count = 0;
+  for (const auto& title : m_titles)
+    m_count += title.second.size();
+}
+
+bool CRecordingStore::FindFileName(const std::string& recordingId, std::string& fileName) const
+{
+  auto fileNames = std::atomic_load(&m_fileNames);
+  auto it = fileNames->find(recordingId);
+  if (it == fileNames->end())
+    return false;
+
+  fileName = it->second;
+  return true;
+}
+
+void CRecordingStore::PublishFileNames()
+{
+  // Build the new snapshot to the side, readers keep using the old one until it is swapped in
+  auto fileNames = std::make_shared<FileNames>();
+  fileNames->reserve(m_count);
+  for (const auto& title : m_titles)
+  {
+    for (const cRecording& recording : title.second)
+      fileNames->emplace(recording.RecordingId(), recording.RecordingFileName());
+  }
+  std::atomic_store(&m_fileNames, std::shared_ptr<const FileNames>(std::move(fileNames)));
+}
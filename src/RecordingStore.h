@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "recording.h"
+
+#include <cstdint>
+#include <functional>
+#include <kodi/AddonBase.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \brief The recordings on the server, grouped by their title
+ *
+ * The first update fetches the list of titles and the recordings of every title. After that
+ * only the titles that were reported as changed are fetched again, one request per title.
+ * Every update that fetched something starts a new generation. The file names of the
+ * recordings are published as an immutable snapshot, so that lookups never wait for an update.
+ */
+class ATTR_DLL_LOCAL CRecordingStore
+{
+public:
+  using FetchTitlesFunction = std::function<bool(std::vector<std::string>& titles)>;
+  using FetchRecordingsFunction =
+      std::function<bool(const std::string& title, std::vector<cRecording>& recordings)>;
+  using RecordingFunction = std::function<void(const cRecording& recording, size_t titleCount)>;
+
+  CRecordingStore();
+
+  /**
+   * \brief Bring the store up to date
+   *
+   * Does a full refresh when the store was invalidated, otherwise only fetches the changed titles.
+   * Concurrent updates run one after the other, a later one only fetches what is still marked.
+   * \param fetchTitles     Fetches the titles of all recording groups
+   * \param fetchRecordings Fetches the recordings of one title, called from the workers
+   * \param maxWorkers      Upper bound on the number of concurrent requests of a full refresh
+   * \return false when the server could not be reached, the store then keeps its content
+   */
+  bool Update(const FetchTitlesFunction& fetchTitles,
+              const FetchRecordingsFunction& fetchRecordings,
+              int maxWorkers);
+
+  /**
+   * \brief Fetch everything again at the next update
+   */
+  void Invalidate();
+
+  /**
+   * \brief Fetch everything again at the next update, unless recordings were fetched since the
+   * given generation
+   * \param keepChanges Also not when titles are marked as changed, the update fetches only those
+   */
+  void InvalidateIfUnchanged(uint64_t generation, bool keepChanges);
+
+  /**
+   * \brief Fetch the recordings of a title again at the next update
+   */
+  void InvalidateTitle(const std::string& title);
+
+  /**
+   * \brief Call func for every recording, together with the number of recordings of its title
+   * \return The generation of the recordings that func was called for
+   */
+  uint64_t ForEach(const RecordingFunction& func) const;
+
+  /**
+   * \brief Find the file name of a recording by its recording id
+   *
+   * Never blocks, also not while the store is being updated.
+   */
+  bool FindFileName(const std::string& recordingId, std::string& fileName) const;
+
+  /**
+   * \brief Number of recordings in the store
+   */
+  size_t Count() const;
+
+private:
+  // Recording id -> file name
+  using FileNames = std::unordered_map<std::string, std::string>;
+
+  void UpdateCount();
+  void PublishFileNames();
+
+  std::mutex m_updateMutex; // held for a whole update
+  mutable std::mutex m_mutex;
+  std::map<std::string, std::vector<cRecording>> m_titles;
+  std::set<std::string> m_changedTitles;
+  bool m_valid = false;
+  size_t m_count = 0;
+  uint64_t m_generation = 0;
+  std::shared_ptr<const FileNames> m_fileNames;
+};
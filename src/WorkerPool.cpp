@@ -0,0 +1,42 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void CWorkerPool::Run(size_t count, int maxWorkers, const std::function<void(size_t)>& job)
+{
+  if (count == 0)
+    return;
+
+  size_t workers = std::min(count, static_cast<size_t>(std::max(maxWorkers, 1)));
+  if (workers == 1)
+  {
+    for (size_t index = 0; index < count; ++index)
+      job(index);
+    return;
+  }
+
+  // Every worker picks the next unhandled job, so slow jobs don't hold up the others
+  std::atomic<size_t> next = {0};
+  auto worker = [&] {
+    size_t index;
+    while ((index = next++) < count)
+      job(index);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (size_t i = 0; i < workers; ++i)
+    threads.emplace_back(worker);
+  for (auto& thread : threads)
+    thread.join();
+}
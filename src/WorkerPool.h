@@ -0,0 +1,24 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <kodi/AddonBase.h>
+
+class ATTR_DLL_LOCAL CWorkerPool
+{
+public:
+  /**
+   * \brief Run job(0) .. job(count - 1) on at most maxWorkers threads and wait for completion
+   * \param count      Number of jobs
+   * \param maxWorkers Upper bound on the number of concurrently running jobs
+   * \param job        Called once for every job index, possibly from several threads at once
+   */
+  static void Run(size_t count, int maxWorkers, const std::function<void(size_t)>& job);
+};
@@ -22,11 +22,14 @@
 #include "pvrclient-argustv.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <kodi/Filesystem.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <kodi/tools/StringUtils.h>
 #include <memory>
 #include <stdio.h>
-#include <sys/stat.h>
 
 #if defined(TARGET_WINDOWS)
 #include <windows.h>
@@ -39,14 +42,113 @@
 /**
   * \brief Do some internal housekeeping at the start
   */
-void CArgusTV::Initialize(const std::string& baseURL)
+void CArgusTV::Initialize(const std::string& baseURL, bool reuseConnections)
 {
   m_baseURL = baseURL;
+  m_reuseConnections = reuseConnections;
+  m_requests = 0;
+  m_closedConnections = 0;
   //// due to lack of static constructors...
   //curl_global_init(CURL_GLOBAL_ALL);
 }
 
 
+CArgusTV::CConnectionSlot::CConnectionSlot(CArgusTV& rpc, bool bulk) : m_rpc(rpc), m_bulk(bulk)
+{
+  std::unique_lock<std::mutex> lock(m_rpc.m_connectionMutex);
+  m_rpc.m_connectionCondition.wait(lock, [this] {
+    return m_rpc.m_activeConnections < ATV_MAX_CONNECTIONS &&
+           (!m_bulk || m_rpc.m_bulkConnections < ATV_MAX_BULK_CONNECTIONS);
+  });
+  m_rpc.m_activeConnections++;
+  if (m_bulk)
+    m_rpc.m_bulkConnections++;
+}
+
+CArgusTV::CConnectionSlot::~CConnectionSlot()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_rpc.m_connectionMutex);
+    m_rpc.m_activeConnections--;
+    if (m_bulk)
+      m_rpc.m_bulkConnections--;
+  }
+  // Control and bulk requests wait for different conditions
+  m_rpc.m_connectionCondition.notify_all();
+}
+
+bool CArgusTV::OpenRequest(kodi::vfs::CFile& file, const std::string& arguments)
+{
+  file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "Content-Type", "application/json");
+  // HTTP/1.1 keeps connections open by default, so only opting out needs a header
+  if (!m_reuseConnections)
+    file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "Connection", "close");
+  std::string b64encoded = BASE64::b64_encode(reinterpret_cast<const uint8_t*>(arguments.c_str()),
+                                              arguments.length(), false);
+  file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "postdata", b64encoded.c_str());
+
+  return file.CURLOpen(ADDON_READ_NO_CACHE);
+}
+
+void CArgusTV::CloseRequest(kodi::vfs::CFile& file)
+{
+  // The connection stays open for the next request unless the response ends it: HTTP/1.1 keeps it
+  // unless told to close, HTTP/1.0 only when told to keep it alive
+  std::string protocol = file.GetPropertyValue(ADDON_FILE_PROPERTY_RESPONSE_PROTOCOL, "");
+  std::string connection = file.GetPropertyValue(ADDON_FILE_PROPERTY_RESPONSE_HEADER, "Connection");
+  bool kept = protocol.compare(0, 8, "HTTP/1.0") == 0
+                  ? kodi::tools::StringUtils::EqualsNoCase(connection, "keep-alive")
+                  : !kodi::tools::StringUtils::EqualsNoCase(connection, "close");
+  m_requests++;
+  if (!kept || !m_reuseConnections)
+    m_closedConnections++;
+  file.Close();
+}
+
+void CArgusTV::LogConnectionStatistics()
+{
+  uint64_t requests = m_requests;
+  uint64_t closedConnections = m_closedConnections;
+  kodi::Log(ADDON_LOG_INFO,
+            "ARGUS TV: %llu requests, %llu of them closed their connection (%llu%%).",
+            static_cast<unsigned long long>(requests),
+            static_cast<unsigned long long>(closedConnections),
+            static_cast<unsigned long long>(requests > 0 ? closedConnections * 100 / requests : 0));
+}
+
+void CArgusTV::ReadResponse(kodi::vfs::CFile& file, std::string& body)
+{
+  // Size the buffer from the announced length, so that large guide and recording responses
+  // are read without reallocating. One spare byte lets the final read report end of file.
+  int64_t length = file.GetLength();
+  if (length <= 0)
+    length = std::atoll(
+        file.GetPropertyValue(ADDON_FILE_PROPERTY_RESPONSE_HEADER, "Content-Length").c_str());
+  body.resize(length > 0 ? static_cast<size_t>(length) + 1 : ATV_READ_CHUNK_SIZE);
+
+  size_t used = 0;
+  while (true)
+  {
+    // Unknown or wrong length (e.g. compressed transfer): grow geometrically
+    if (used == body.size())
+      body.resize(body.size() * 2);
+    ssize_t bytesRead =
+        file.Read(&body[used], std::min<size_t>(body.size() - used, ATV_READ_CHUNK_SIZE));
+    if (bytesRead <= 0)
+      break;
+    used += static_cast<size_t>(bytesRead);
+  }
+  body.resize(used);
+}
+
+long CArgusTV::ResponseCode(kodi::vfs::CFile& file)
+{
+  // The status line, e.g. "HTTP/1.1 304 Not Modified"
+  std::string protocol = file.GetPropertyValue(ADDON_FILE_PROPERTY_RESPONSE_PROTOCOL, "");
+  size_t space = protocol.find(' ');
+  return space != std::string::npos ? std::atol(protocol.c_str() + space + 1) : 0;
+}
+
 // The usable urls:
 //http://localhost:49943/ArgusTV/Control/help
 //http://localhost:49943/ArgusTV/Scheduler/help
@@ -59,7 +161,7 @@ int CArgusTV::ArgusTVRPC(const std::string& command,
                          const std::string& arguments,
                          std::string& json_response)
 {
-  std::lock_guard<std::mutex> critsec(m_communicationMutex);
+  CConnectionSlot slot(*this);
   std::string url = m_baseURL + command;
   int retval = E_FAILED;
   kodi::Log(ADDON_LOG_DEBUG, "URL: %s\n", url.c_str());
@@ -67,20 +169,11 @@ int CArgusTV::ArgusTVRPC(const std::string& command,
   kodi::vfs::CFile file;
   if (file.CURLCreate(url))
   {
-    file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "Content-Type", "application/json");
-    std::string b64encoded = BASE64::b64_encode(reinterpret_cast<const uint8_t*>(arguments.c_str()),
-                                                arguments.length(), false);
-    file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "postdata", b64encoded.c_str());
-
-    if (file.CURLOpen(ADDON_READ_NO_CACHE))
+    if (OpenRequest(file, arguments))
     {
-      std::string result;
-      result.clear();
-      std::string buffer;
-      while (file.ReadLine(buffer))
-        result.append(buffer);
-      json_response = result;
+      ReadResponse(file, json_response);
       retval = 0;
+      CloseRequest(file);
     }
     else
     {
@@ -99,7 +192,7 @@ int CArgusTV::ArgusTVRPCToFile(const std::string& command,
                                std::string& filename,
                                long& http_response)
 {
-  std::lock_guard<std::mutex> critsec(m_communicationMutex);
+  CConnectionSlot slot(*this);
   std::string url = m_baseURL + command;
   int retval = E_FAILED;
   kodi::Log(ADDON_LOG_DEBUG, "URL: %s writing to file %s\n", url.c_str(), filename.c_str());
@@ -115,16 +208,12 @@ int CArgusTV::ArgusTVRPCToFile(const std::string& command,
     kodi::vfs::CFile file;
     if (file.CURLCreate(url))
     {
-      file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "Content-Type", "application/json");
-      std::string b64encoded = BASE64::b64_encode(
-          reinterpret_cast<const uint8_t*>(arguments.c_str()), arguments.length(), false);
-      file.CURLAddOption(ADDON_CURL_OPTION_PROTOCOL, "postdata", b64encoded.c_str());
-
-      if (file.CURLOpen(ADDON_READ_NO_CACHE))
+      if (OpenRequest(file, arguments))
       {
         unsigned char buffer[1024];
         int bytesRead = 0;
         retval = 0;
+        http_response = ResponseCode(file);
         do
         {
           bytesRead = file.Read(buffer, sizeof(buffer));
@@ -139,6 +228,7 @@ int CArgusTV::ArgusTVRPCToFile(const std::string& command,
             break;
           }
         } while (bytesRead == sizeof(buffer));
+        CloseRequest(file);
       }
       else
       {
@@ -196,76 +286,105 @@ int CArgusTV::ArgusTVJSONRPC(const std::string& command,
   return retval;
 }
 
-/*
-  * \brief Get the logo for a channel
-  * \param channelGUID GUID of the channel
-  */
-std::string CArgusTV::GetChannelLogo(const std::string& channelGUID)
+int CArgusTV::ArgusTVJSONArrayRPC(const std::string& command,
+                                  const std::string& arguments,
+                                  const CJsonArrayReader::ElementCallback& onElement,
+                                  bool bulk)
 {
-#if defined(TARGET_WINDOWS)
-  char tmppath[MAX_PATH];
-  GetTempPathA(MAX_PATH, tmppath);
-#elif defined(TARGET_LINUX) || defined(TARGET_DARWIN) || defined(TARGET_FREEBSD)
-  std::string tmppath = "/tmp/";
-#else
-#error implement for your OS!
-#endif
-  std::string finalpath = tmppath;
-  finalpath += channelGUID;
-  std::string path = finalpath;
-  finalpath += ".png";
-  path += ".$$$";
+  CConnectionSlot slot(*this, bulk);
+  std::string url = m_baseURL + command;
+  kodi::Log(ADDON_LOG_DEBUG, "URL: %s\n", url.c_str());
 
-  struct tm* modificationtime;
-  struct stat buf;
-  if (stat(finalpath.c_str(), &buf) != -1)
+  kodi::vfs::CFile file;
+  if (!file.CURLCreate(url))
   {
-    modificationtime = localtime((const time_t*)&buf.st_mtime);
+    kodi::Log(ADDON_LOG_ERROR, "can not open %s for write", url.c_str());
+    return E_FAILED;
   }
-  else
+  if (!OpenRequest(file, arguments))
   {
-    time_t prehistoric = 0;
-    modificationtime = localtime(&prehistoric);
+    kodi::Log(ADDON_LOG_ERROR, "can not write to %s", url.c_str());
+    return E_FAILED;
   }
 
-  char command[512];
-
-  snprintf(command, 512, "ArgusTV/Scheduler/ChannelLogo/%s/100/100/false/%d-%02d-%02d",
-           channelGUID.c_str(), modificationtime->tm_year + 1900, modificationtime->tm_mon + 1,
-           modificationtime->tm_mday);
+  // Parse every chunk as soon as it arrives, only the element being read is kept
+  CJsonArrayReader reader(onElement);
+  std::string buffer(ATV_READ_CHUNK_SIZE, '\0');
+  bool received = false;
+  bool valid = true;
+  ssize_t bytesRead;
+  while (valid && (bytesRead = file.Read(&buffer[0], buffer.size())) > 0)
+  {
+    received = true;
+    valid = reader.Feed(buffer.data(), static_cast<size_t>(bytesRead));
+  }
+  CloseRequest(file);
 
-  long http_response;
-  int retval = ArgusTVRPCToFile(command, "", path, http_response);
-  if (retval != 0)
+  if (!received)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "Empty response");
+    return E_EMPTYRESPONSE;
+  }
+  if (!valid || !reader.Finish())
   {
-    kodi::Log(ADDON_LOG_ERROR, "couldn't retrieve the temporary channel logo file %s.\n",
-              path.c_str());
-    return "";
+    kodi::Log(ADDON_LOG_DEBUG, "Failed to parse the array response of %s after %zu elements",
+              command.c_str(), reader.Count());
+    return E_FAILED;
   }
 
-  if (http_response == 200)
+  return static_cast<int>(reader.Count());
+}
+
+/*
+  * \brief Download the logo of a channel
+  * \param channelGUID GUID of the channel
+  */
+int CArgusTV::GetChannelLogo(const std::string& channelGUID,
+                             time_t modifiedAfter,
+                             std::string& etag,
+                             std::string& image)
+{
+  struct tm modificationtime = LocalTime(modifiedAfter);
+  char command[512];
+  snprintf(command, 512, "ArgusTV/Scheduler/ChannelLogo/%s/100/100/false/%d-%02d-%02d",
+           channelGUID.c_str(), modificationtime.tm_year + 1900, modificationtime.tm_mon + 1,
+           modificationtime.tm_mday);
+
+  CConnectionSlot slot(*this, true);
+  std::string url = m_baseURL + command;
+  kodi::Log(ADDON_LOG_DEBUG, "URL: %s\n", url.c_str());
+
+  kodi::vfs::CFile file;
+  if (!file.CURLCreate(url))
   {
-    (void)remove(finalpath.c_str());
-    if (rename(path.c_str(), finalpath.c_str()) == -1)
-    {
-      kodi::Log(ADDON_LOG_ERROR, "couldn't rename temporary channel logo file %s to %s.\n",
-                path.c_str(), finalpath.c_str());
-      finalpath = "";
-    }
+    kodi::Log(ADDON_LOG_ERROR, "can not open %s for write", url.c_str());
+    return E_FAILED;
   }
-  else
+  if (!etag.empty())
+    file.CURLAddOption(ADDON_CURL_OPTION_HEADER, "If-None-Match", etag);
+  if (!OpenRequest(file, ""))
   {
-    // cleanup temporary file
-    if (remove(path.c_str()) == -1)
-      kodi::Log(ADDON_LOG_ERROR, "couldn't delete temporary channel logo file %s.\n", path.c_str());
-    // so was the logo not there (204) or was our local version still valid (304)?
-    if (http_response == 204)
-    {
-      finalpath = "";
-    }
+    kodi::Log(ADDON_LOG_ERROR, "couldn't retrieve the logo of channel %s.", channelGUID.c_str());
+    return E_FAILED;
   }
 
-  return finalpath;
+  long http_response = ResponseCode(file);
+  std::string newEtag = file.GetPropertyValue(ADDON_FILE_PROPERTY_RESPONSE_HEADER, "ETag");
+  ReadResponse(file, image);
+  CloseRequest(file);
+
+  // Without a status line only the body tells whether there was a logo
+  if (http_response == 0)
+    http_response = image.empty() ? 204 : 200;
+  if (http_response != 200 && http_response != 204 && http_response != 304)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "unexpected HTTP status %ld for the logo of channel %s.",
+              http_response, channelGUID.c_str());
+    return E_FAILED;
+  }
+  if (http_response != 304)
+    etag = newEtag;
+  return static_cast<int>(http_response);
 }
 
 /*
@@ -546,14 +665,17 @@ int CArgusTV::TuneLiveStream(const std::string& channel_id,
            "\"LiveStream\":",
            channel_id.c_str(), channeltype, channelname.c_str());
   std::string arguments = command;
-  if (!m_currentLivestream.empty())
-  {
-    Json::StreamWriterBuilder wbuilder;
-    arguments.append(Json::writeString(wbuilder, m_currentLivestream)).append("}");
-  }
-  else
   {
-    arguments.append("null}");
+    std::lock_guard<std::mutex> lock(m_livestreamMutex);
+    if (!m_currentLivestream.empty())
+    {
+      Json::StreamWriterBuilder wbuilder;
+      arguments.append(Json::writeString(wbuilder, m_currentLivestream)).append("}");
+    }
+    else
+    {
+      arguments.append("null}");
+    }
   }
 
   kodi::Log(ADDON_LOG_DEBUG, "ArgusTV/Control/TuneLiveStream, body [%s]", arguments.c_str());
@@ -578,6 +700,7 @@ int CArgusTV::TuneLiveStream(const std::string& channel_id,
       Json::Value livestream = response["LiveStream"];
       if (livestream != Json::nullValue)
       {
+        std::lock_guard<std::mutex> lock(m_livestreamMutex);
         m_currentLivestream = livestream;
       }
       else
@@ -585,7 +708,7 @@ int CArgusTV::TuneLiveStream(const std::string& channel_id,
         kodi::Log(ADDON_LOG_DEBUG, "No LiveStream received from server.");
         return E_FAILED;
       }
-      stream = m_currentLivestream["TimeshiftFile"].asString();
+      stream = livestream["TimeshiftFile"].asString();
       //stream = m_currentLivestream["RtspUrl"].asString();
       kodi::Log(ADDON_LOG_DEBUG, "Tuned live stream: %s\n", stream.c_str());
       return E_SUCCESS;
@@ -606,16 +729,19 @@ int CArgusTV::TuneLiveStream(const std::string& channel_id,
 
 int CArgusTV::StopLiveStream()
 {
-  if (!m_currentLivestream.empty())
+  Json::Value livestream;
+  {
+    std::lock_guard<std::mutex> lock(m_livestreamMutex);
+    livestream.swap(m_currentLivestream);
+  }
+  if (!livestream.empty())
   {
     Json::StreamWriterBuilder wbuilder;
-    std::string arguments = Json::writeString(wbuilder, m_currentLivestream);
+    std::string arguments = Json::writeString(wbuilder, livestream);
 
     std::string response;
     int retval = ArgusTVRPC("ArgusTV/Control/StopLiveStream", arguments, response);
 
-    m_currentLivestream.clear();
-
     return retval;
   }
   else
@@ -628,6 +754,7 @@ std::string CArgusTV::GetLiveStreamURL(void)
 {
   std::string stream = "";
 
+  std::lock_guard<std::mutex> lock(m_livestreamMutex);
   if (!m_currentLivestream.empty())
   {
     stream = m_currentLivestream["RtspUrl"].asString();
@@ -637,10 +764,13 @@ std::string CArgusTV::GetLiveStreamURL(void)
 
 int CArgusTV::SignalQuality(Json::Value& response)
 {
+  std::unique_lock<std::mutex> lock(m_livestreamMutex);
   if (!m_currentLivestream.empty())
   {
     Json::StreamWriterBuilder wbuilder;
     std::string arguments = Json::writeString(wbuilder, m_currentLivestream);
+    // the tuning details don't depend on request ordering, so don't block a zap
+    lock.unlock();
 
     int retval = ArgusTVJSONRPC("ArgusTV/Control/GetLiveStreamTuningDetails", arguments, response);
 
@@ -663,10 +793,12 @@ bool CArgusTV::KeepLiveStreamAlive()
   //{"CardId":"String content","Channel":{"BroadcastStart":"String content","BroadcastStop":"String content","ChannelId":"1627aea5-8e0a-4371-9022-9b504344e724","ChannelType":0,"DefaultPostRecordSeconds":2147483647,"DefaultPreRecordSeconds":2147483647,"DisplayName":"String content","GuideChannelId":"1627aea5-8e0a-4371-9022-9b504344e724","LogicalChannelNumber":2147483647,"Sequence":2147483647,"Version":2147483647,"VisibleInGuide":true},"RecorderTunerId":"1627aea5-8e0a-4371-9022-9b504344e724","RtspUrl":"String content","StreamLastAliveTime":"\/Date(928142400000+0200)\/","StreamStartedTime":"\/Date(928142400000+0200)\/","TimeshiftFile":"String content"}
   //Example response:
   //true
+  std::unique_lock<std::mutex> lock(m_livestreamMutex);
   if (!m_currentLivestream.empty())
   {
     Json::StreamWriterBuilder wbuilder;
     std::string arguments = Json::writeString(wbuilder, m_currentLivestream);
+    lock.unlock();
 
     Json::Value response;
     int retval = ArgusTVJSONRPC("ArgusTV/Control/KeepLiveStreamAlive", arguments, response);
@@ -706,6 +838,27 @@ int CArgusTV::GetEPGData(const std::string& guidechannel_id,
   return E_FAILED;
 }
 
+int CArgusTV::GetEPGData(const std::string& guidechannel_id,
+                         struct tm epg_start,
+                         struct tm epg_end,
+                         const CJsonArrayReader::ElementCallback& onProgram)
+{
+  if (guidechannel_id.length() > 0)
+  {
+    char command[256];
+
+    //Format: ArgusTV/Guide/Programs/{guideChannelId}/{lowerTime}/{upperTime}
+    snprintf(command, 256, ATV_GETEPG_45, guidechannel_id.c_str(), epg_start.tm_year + 1900,
+             epg_start.tm_mon + 1, epg_start.tm_mday, epg_start.tm_hour, epg_start.tm_min,
+             epg_start.tm_sec, epg_end.tm_year + 1900, epg_end.tm_mon + 1, epg_end.tm_mday,
+             epg_end.tm_hour, epg_end.tm_min, epg_end.tm_sec);
+
+    return ArgusTVJSONArrayRPC(command, "", onProgram, true);
+  }
+
+  return E_FAILED;
+}
+
 int CArgusTV::GetRecordingGroupByTitle(Json::Value& response)
 {
   kodi::Log(ADDON_LOG_DEBUG, "GetRecordingGroupByTitle");
@@ -729,7 +882,8 @@ int CArgusTV::GetRecordingGroupByTitle(Json::Value& response)
   return retval;
 }
 
-int CArgusTV::GetFullRecordingsForTitle(const std::string& title, Json::Value& response)
+int CArgusTV::GetFullRecordingsForTitle(const std::string& title,
+                                        const CJsonArrayReader::ElementCallback& onRecording)
 {
   kodi::Log(ADDON_LOG_DEBUG, "GetFullRecordingsForTitle(\"%s\")", title.c_str());
   std::string command = "ArgusTV/Control/GetFullRecordings/Television?includeNonExisting=false";
@@ -741,7 +895,7 @@ int CArgusTV::GetFullRecordingsForTitle(const std::string& title, Json::Value& r
   Json::StreamWriterBuilder wbuilder;
   std::string arguments = Json::writeString(wbuilder, jsArgument);
 
-  int retval = CArgusTV::ArgusTVJSONRPC(command, arguments, response);
+  int retval = CArgusTV::ArgusTVJSONArrayRPC(command, arguments, onRecording, true);
   if (retval < 0)
   {
     kodi::Log(ADDON_LOG_INFO, "GetFullRecordingsForTitle remote call failed. (%d)", retval);
@@ -982,29 +1136,15 @@ int CArgusTV::GetUpcomingPrograms(Json::Value& response)
 /**
   * \brief Fetch the list of upcoming recordings
   */
-int CArgusTV::GetUpcomingRecordings(Json::Value& response)
+int CArgusTV::GetUpcomingRecordings(const CJsonArrayReader::ElementCallback& onRecording)
 {
-  int retval = -1;
-
   kodi::Log(ADDON_LOG_DEBUG, "GetUpcomingRecordings");
 
   // http://madcat:49943/ArgusTV/Control/UpcomingRecordings/7?includeCancelled=true
-  retval = ArgusTVJSONRPC("ArgusTV/Control/UpcomingRecordings/7?includeActive=true", "", response);
+  int retval = ArgusTVJSONArrayRPC("ArgusTV/Control/UpcomingRecordings/7?includeActive=true", "",
+                                   onRecording);
 
-  if (retval >= 0)
-  {
-    if (response.type() == Json::arrayValue)
-    {
-      int size = response.size();
-      return size;
-    }
-    else
-    {
-      kodi::Log(ADDON_LOG_DEBUG, "Unknown response format. Expected Json::arrayValue\n");
-      return -1;
-    }
-  }
-  else
+  if (retval < 0)
   {
     kodi::Log(ADDON_LOG_DEBUG, "GetUpcomingRecordings failed. Return value: %i\n", retval);
   }
@@ -1492,26 +1632,58 @@ int CArgusTV::lifetimeToKeepUntilValue(int lifetime)
   return lifetime;
 }
 
-time_t CArgusTV::WCFDateToTimeT(const std::string& wcfdate, int& offset)
+time_t CArgusTV::WCFDateToTimeT(const char* wcfdate, size_t length, int& offset)
 {
-  time_t ticks;
-  char offsetc;
-  int offsetv;
-
-  if (wcfdate.empty())
+  //WCF compatible format "/Date(1290896700000+0100)/" => 2010-11-27 23:25:00
+  //The tick value counts milliseconds since 1970 and may be negative
+  const char* end = wcfdate + length;
+  const char* p = static_cast<const char*>(memchr(wcfdate, '(', length));
+  if (p == nullptr)
   {
     return 0;
   }
+  p++;
 
-  //WCF compatible format "/Date(1290896700000+0100)/" => 2010-11-27 23:25:00
-  ticks = atoi(
-      wcfdate.substr(6, 10).c_str()); //only take the first 10 chars (fits in a 32-bit time_t value)
-  offsetc = wcfdate[19]; // + or -
-  offsetv = atoi(wcfdate.substr(20, 4).c_str());
+  bool negative = (p < end && *p == '-');
+  if (negative)
+    p++;
+  int64_t milliseconds = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; p++)
+  {
+    if (milliseconds < INT64_MAX / 10)
+      milliseconds = milliseconds * 10 + (*p - '0');
+  }
 
+  int offsetv = 0;
+  char offsetc = '+';
+  if (p < end && (*p == '+' || *p == '-'))
+  {
+    offsetc = *p++;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+      offsetv = offsetv * 10 + (*p - '0');
+  }
   offset = (offsetc == '+' ? offsetv : -offsetv);
 
-  return ticks;
+  // round towards the past, so that -1 ms is the last second before 1970
+  int64_t seconds = negative ? -((milliseconds + 999) / 1000) : milliseconds / 1000;
+  return static_cast<time_t>(seconds);
+}
+
+time_t CArgusTV::WCFDateToTimeT(const std::string& wcfdate, int& offset)
+{
+  return WCFDateToTimeT(wcfdate.c_str(), wcfdate.size(), offset);
+}
+
+time_t CArgusTV::WCFDateToTimeT(const Json::Value& wcfdate, int& offset)
+{
+  // Use the string stored in the value itself, asString() would copy it
+  const char* begin;
+  const char* end;
+  if (!wcfdate.isString() || !wcfdate.getString(&begin, &end))
+  {
+    return 0;
+  }
+  return WCFDateToTimeT(begin, static_cast<size_t>(end - begin), offset);
 }
 
 std::string CArgusTV::TimeTToWCFDate(const time_t thetime)
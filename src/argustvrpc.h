@@ -8,9 +8,14 @@
 
 #pragma once
 
+#include "JsonArrayReader.h"
+
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <json/json.h>
 #include <kodi/AddonBase.h>
+#include <kodi/Filesystem.h>
 #include <mutex>
 #include <string>
 
@@ -22,6 +27,15 @@
 #define E_FAILED -1
 #define E_EMPTYRESPONSE -2
 
+// Maximum number of REST requests that are in flight at the same time
+#define ATV_MAX_CONNECTIONS 12
+// Of those, the number kept free for control requests: tuning, keeping the live stream alive,
+// timers and service events never queue behind bulk downloads of guide data, recordings or logos
+#define ATV_CONTROL_CONNECTIONS 2
+#define ATV_MAX_BULK_CONNECTIONS (ATV_MAX_CONNECTIONS - ATV_CONTROL_CONNECTIONS)
+// Size of the chunks in which response bodies are read
+#define ATV_READ_CHUNK_SIZE (64 * 1024)
+
 class ATTR_DLL_LOCAL CArgusTV
 {
 public:
@@ -94,8 +108,16 @@ public:
 
   /**
    * \brief Do some internal housekeeping at the start
+   * \param baseURL          The URL of the ARGUS TV webservice
+   * \param reuseConnections When false, ask the server to close connections after each request
+   */
+  void Initialize(const std::string& baseURL, bool reuseConnections = true);
+
+  /**
+   * \brief Log how many requests were made since Initialize() and how many of them closed their
+   * connection, so that the next request had to open a new one
    */
-  void Initialize(const std::string& baseURL);
+  void LogConnectionStatistics();
 
   /**
    * \brief Send a REST command to ARGUS and return the JSON response string
@@ -117,6 +139,19 @@ public:
                      const std::string& arguments,
                      Json::Value& json_response);
 
+  /**
+   * \brief Send a REST command to ARGUS that returns a JSON array and parse it while it is
+   *        being downloaded. The callback must not issue requests itself.
+   * \param command       The command string url (starting from "ArgusTV/")
+   * \param onElement     Called for every element of the array, in order
+   * \param bulk          Part of a bulk download, limited to ATV_MAX_BULK_CONNECTIONS
+   * \return the number of elements on ok, -1 on a failure, -2 on an empty response
+   */
+  int ArgusTVJSONArrayRPC(const std::string& command,
+                          const std::string& arguments,
+                          const CJsonArrayReader::ElementCallback& onElement,
+                          bool bulk = false);
+
   /**
    * \brief Send a REST command to ARGUS, write the response to a file and return the filename
    * \param command       The command string url (starting from "ArgusTV/")
@@ -210,6 +245,19 @@ public:
                  struct tm epg_end,
                  Json::Value& response);
 
+  /**
+   * \brief Stream the EPG data for the given guidechannel id, program by program
+   * \param guidechannel_id  String containing the ARGUS guidechannel_id (not the channel_id)
+   * \param epg_start        Start from this date
+   * \param epg_stop         Until this date
+   * \param onProgram        Called for every guide program while the response is downloaded
+   * \return the number of programs or a negative error code
+   */
+  int GetEPGData(const std::string& guidechannel_id,
+                 struct tm epg_start,
+                 struct tm epg_end,
+                 const CJsonArrayReader::ElementCallback& onProgram);
+
   /**
    * \brief Fetch the recording groups sorted by title
    * \param response Reference to a std::string used to store the json response string
@@ -217,11 +265,13 @@ public:
   int GetRecordingGroupByTitle(Json::Value& response);
 
   /**
-   * \brief Fetch the detailed data for all recordings for a given title
+   * \brief Stream the detailed data for all recordings for a given title
    * \param title Program title of recording
-   * \param response Reference to a std::string used to store the json response string
+   * \param onRecording Called for every recording while the response is downloaded
+   * \return the number of recordings or a negative error code
    */
-  int GetFullRecordingsForTitle(const std::string& title, Json::Value& response);
+  int GetFullRecordingsForTitle(const std::string& title,
+                                const CJsonArrayReader::ElementCallback& onRecording);
 
   /**
    * \brief Fetch the detailed information of a recorded show
@@ -292,9 +342,11 @@ public:
   int GetUpcomingPrograms(Json::Value& response);
 
   /**
-   * \brief Fetch the list of upcoming recordings
+   * \brief Stream the list of upcoming recordings
+   * \param onRecording Called for every upcoming recording while the response is downloaded
+   * \return the number of upcoming recordings or a negative error code
    */
-  int GetUpcomingRecordings(Json::Value& response);
+  int GetUpcomingRecordings(const CJsonArrayReader::ElementCallback& onRecording);
 
   /**
    * \brief Fetch the list of currently active recordings
@@ -374,10 +426,18 @@ public:
   int RequestChannelGroupMembers(const std::string& channelGroupId, Json::Value& response);
 
   /*
-   * \brief Get the logo for a channel
-   * \param channelGUID GUID of the channel
-   */
-  std::string GetChannelLogo(const std::string& channelGUID);
+   * \brief Download the logo of a channel
+   * \param channelGUID   GUID of the channel
+   * \param modifiedAfter Only return the logo when it changed after this date (0 = always)
+   * \param etag          ETag of the local copy, empty when unknown. Receives the new ETag.
+   * \param image         Receives the PNG data when the logo was returned
+   * \return The HTTP status: 200 (logo returned), 204 (no logo) or 304 (not modified), or
+   *         E_FAILED
+   */
+  int GetChannelLogo(const std::string& channelGUID,
+                     time_t modifiedAfter,
+                     std::string& etag,
+                     std::string& image);
 
   /*
    * \brief Subscribe to ARGUS TV service events
@@ -406,16 +466,61 @@ public:
    */
   int lifetimeToKeepUntilValue(int lifetime);
 
+  /**
+   * \brief Convert a WCF date ("/Date(1290896700000+0100)/") to a time_t without allocating
+   * \param wcfdate Points to the date text, which does not need to be null terminated
+   * \param length  Length of the date text
+   * \param offset  Receives the UTC offset as hhmm, e.g. 100 for +0100
+   */
+  static time_t WCFDateToTimeT(const char* wcfdate, size_t length, int& offset);
   static time_t WCFDateToTimeT(const std::string& wcfdate, int& offset);
+  static time_t WCFDateToTimeT(const Json::Value& wcfdate, int& offset);
   static std::string TimeTToWCFDate(const time_t thetime);
 
 private:
+  /**
+   * \brief Claims one of the ATV_MAX_CONNECTIONS connection slots for its lifetime
+   *
+   * Bulk requests only get one of the first ATV_MAX_BULK_CONNECTIONS slots.
+   */
+  class CConnectionSlot
+  {
+  public:
+    CConnectionSlot(CArgusTV& rpc, bool bulk = false);
+    ~CConnectionSlot();
+
+  private:
+    CArgusTV& m_rpc;
+    bool m_bulk;
+  };
+
+  bool OpenRequest(kodi::vfs::CFile& file, const std::string& arguments);
+  void CloseRequest(kodi::vfs::CFile& file);
+  /**
+   * \brief Reads the complete response body of an opened request into body
+   */
+  void ReadResponse(kodi::vfs::CFile& file, std::string& body);
+  /**
+   * \brief The HTTP status code of an opened request, 0 when unknown
+   */
+  long ResponseCode(kodi::vfs::CFile& file);
   int RequestChannelGroups(enum ChannelType channelType, Json::Value& response);
   int GetLiveStreams();
 
   //Remember the last LiveStream object to be able to stop the stream again
+  //m_livestreamMutex guards the object only, it is not held during requests
   Json::Value m_currentLivestream;
+  std::mutex m_livestreamMutex;
 
   std::string m_baseURL;
-  std::mutex m_communicationMutex;
+
+  std::mutex m_connectionMutex;
+  std::condition_variable m_connectionCondition;
+  int m_activeConnections = 0;
+  int m_bulkConnections = 0;
+
+  bool m_reuseConnections = true;
+  // Requests made and requests after which the connection was closed, read from the responses
+  std::atomic<uint64_t> m_requests = {0};
+  std::atomic<uint64_t> m_closedConnections = {0};
 }; // class ArgusTV
@@ -16,6 +16,23 @@
 #include <stdio.h>
 #include <vector>
 
+cEpg::cEpg(const std::string& guideprogramid,
+           const std::string& title,
+           const std::string& subtitle,
+           const std::string& description,
+           const std::string& genre,
+           time_t starttime,
+           time_t endtime)
+  : m_guideprogramid(guideprogramid),
+    m_title(title),
+    m_subtitle(subtitle),
+    m_description(description),
+    m_genre(genre),
+    m_starttime(starttime),
+    m_endtime(endtime)
+{
+}
+
 void cEpg::Reset()
 {
   m_guideprogramid.clear();
@@ -64,11 +81,8 @@ bool cEpg::Parse(const Json::Value& data)
     m_genre = data["Category"].asString();
 
     // Dates are returned in a WCF compatible format ("/Date(9991231231+0100)/")
-    std::string starttime = data["StartTime"].asString();
-    std::string endtime = data["StopTime"].asString();
-
-    m_starttime = CArgusTV::WCFDateToTimeT(starttime, offset);
-    m_endtime = CArgusTV::WCFDateToTimeT(endtime, offset);
+    m_starttime = CArgusTV::WCFDateToTimeT(data["StartTime"], offset);
+    m_endtime = CArgusTV::WCFDateToTimeT(data["StopTime"], offset);
 
     //kodi::Log(ADDON_LOG_DEBUG, "Program: %s,%s Start: %s", m_title.c_str(), m_subtitle.c_str(), ctime(&m_starttime));
     //kodi::Log(ADDON_LOG_DEBUG, "End: %s", ctime(&m_endtime));
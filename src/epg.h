@@ -16,6 +16,13 @@ class ATTR_DLL_LOCAL cEpg
 {
 public:
   cEpg() = default;
+  cEpg(const std::string& guideprogramid,
+       const std::string& title,
+       const std::string& subtitle,
+       const std::string& description,
+       const std::string& genre,
+       time_t starttime,
+       time_t endtime);
   virtual ~cEpg() = default;
 
   void Reset();
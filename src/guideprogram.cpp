@@ -17,7 +17,6 @@
 bool cGuideProgram::Parse(const Json::Value& data)
 {
   int offset;
-  std::string t;
   //actors = data["Actors"].   .asString();
   category = data["Category"].asString();
   description = data["Description"].asString();
@@ -33,17 +32,14 @@ bool cGuideProgram::Parse(const Json::Value& data)
   isdeleted = data["IsDeleted"].asBool();
   ispremiere = data["IsPremiere"].asBool();
   isrepeat = data["IsRepeat"].asBool();
-  t = data["LastModifiedTime"].asString();
-  lastmodifiedtime = CArgusTV::WCFDateToTimeT(t, offset);
+  lastmodifiedtime = CArgusTV::WCFDateToTimeT(data["LastModifiedTime"], offset);
   lastmodifiedtime += ((offset / 100) * 3600);
   rating = data["Rating"].asString();
   seriesnumber = data["SeriesNumber"].asInt();
   starrating = data["StarRating"].asDouble();
-  t = data["StartTime"].asString();
-  starttime = CArgusTV::WCFDateToTimeT(t, offset);
+  starttime = CArgusTV::WCFDateToTimeT(data["StartTime"], offset);
   starttime += ((offset / 100) * 3600);
-  t = data["StopTime"].asString();
-  stoptime = CArgusTV::WCFDateToTimeT(t, offset);
+  stoptime = CArgusTV::WCFDateToTimeT(data["StopTime"], offset);
   stoptime += ((offset / 100) * 3600);
   subtitle = data["SubTitle"].asString();
   title = data["Title"].asString();
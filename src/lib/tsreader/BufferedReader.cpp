@@ -0,0 +1,330 @@
+/*
+ *  Copyright (C) 2005-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "BufferedReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <kodi/General.h>
+
+namespace ArgusTV
+{
+
+BufferedReader::BufferedReader(FileReader* source, size_t bufferSize, size_t readSize)
+  : m_source(source),
+    m_readSize(std::max<size_t>(1, std::min(readSize, bufferSize))),
+    m_buffer((bufferSize + m_readSize - 1) / m_readSize * m_readSize),
+    m_block(m_readSize)
+{
+}
+
+BufferedReader::~BufferedReader()
+{
+  StopThread();
+}
+
+std::string BufferedReader::GetFileName() const
+{
+  return m_source->GetFileName();
+}
+
+long BufferedReader::SetFileName(const std::string& fileName)
+{
+  return m_source->SetFileName(fileName);
+}
+
+long BufferedReader::OpenFile()
+{
+  // The reader thread only starts with the first read, the source is still ours
+  long hr = m_source->OpenFile();
+  PublishSource();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_seekPending = false;
+  m_zapPending = false;
+  Drop(m_source->GetFilePointer());
+  return hr;
+}
+
+long BufferedReader::CloseFile()
+{
+  StopThread();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_seekPending = false;
+    m_zapPending = false;
+    Drop(SourcePosition());
+    if (m_seeksInBuffer + m_seeksDropped > 0)
+    {
+      kodi::Log(ADDON_LOG_DEBUG,
+                "BufferedReader: %u seeks served from the buffer, %u dropped it.",
+                m_seeksInBuffer, m_seeksDropped);
+    }
+    m_seeksInBuffer = 0;
+    m_seeksDropped = 0;
+  }
+  long hr = m_source->CloseFile();
+  m_sourceInvalid = true;
+  return hr;
+}
+
+bool BufferedReader::IsFileInvalid()
+{
+  return m_sourceInvalid;
+}
+
+long BufferedReader::Read(unsigned char* pbData,
+                          unsigned long lDataLength,
+                          unsigned long* dwReadBytes)
+{
+  *dwReadBytes = 0;
+
+  StartThread();
+
+  // The lock is never held during a read of the source, only while a block is copied in
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto available = [this] {
+    return m_writeCount.load(std::memory_order_relaxed) -
+           m_readCount.load(std::memory_order_relaxed);
+  };
+  m_dataAvailable.wait_for(lock, std::chrono::milliseconds(BUFFEREDREADER_WAIT_TIMEOUT),
+                           [&available] { return available() > 0; });
+
+  size_t length = static_cast<size_t>(std::min<uint64_t>(available(), lDataLength));
+  if (length == 0)
+    return S_FALSE;
+
+  // Copy in at most two parts, the data may wrap around the end of the ring
+  uint64_t readCount = m_readCount.load(std::memory_order_relaxed);
+  size_t offset = static_cast<size_t>(readCount % m_buffer.size());
+  size_t first = std::min(length, m_buffer.size() - offset);
+  memcpy(pbData, &m_buffer[offset], first);
+  memcpy(pbData + first, &m_buffer[0], length - first);
+  m_readCount.store(readCount + length, std::memory_order_release);
+  m_spaceAvailable.notify_one();
+
+  *dwReadBytes = static_cast<unsigned long>(length);
+  return S_OK;
+}
+
+bool BufferedReader::WaitForData(unsigned int timeoutMs)
+{
+  StartThread();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_dataAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+    return m_writeCount.load(std::memory_order_relaxed) -
+               m_readCount.load(std::memory_order_relaxed) >=
+           BUFFEREDREADER_TS_PACKET_SIZE;
+  });
+}
+
+void BufferedReader::StartThread()
+{
+  // Start reading ahead when the consumer first asks for data, after it positioned the stream
+  if (!m_thread.joinable())
+    m_thread = std::thread(&BufferedReader::Process, this);
+}
+
+void BufferedReader::Process()
+{
+  int idle = BUFFEREDREADER_IDLE_MIN;
+  while (!m_stop)
+  {
+    uint64_t epoch;
+    bool zap;
+    bool seek;
+    int64_t seekTarget;
+    int64_t position;
+    size_t offset = 0;
+    size_t length = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      epoch = m_epoch;
+      zap = m_zapPending;
+      seek = m_seekPending;
+      seekTarget = m_seekTarget;
+      m_zapPending = false;
+      m_seekPending = false;
+      position = SourcePosition();
+
+      // Read up to the next block boundary in the file. The ring is a multiple of the block
+      // size and aligned to the file, so a block never wraps around.
+      uint64_t writeCount = m_writeCount.load(std::memory_order_relaxed);
+      size_t used = static_cast<size_t>(writeCount - m_readCount.load(std::memory_order_relaxed));
+      offset = static_cast<size_t>(writeCount % m_buffer.size());
+      length = std::min(m_buffer.size() - offset,
+                        m_readSize - static_cast<size_t>(position % m_readSize));
+      if (length > m_buffer.size() - used)
+        length = 0;
+    }
+
+    if (zap || seek)
+    {
+      // Carry out what the consumer asked for, the ring was dropped already
+      if (zap)
+        m_source->OnZap();
+      if (seek)
+        m_source->SetFilePointer(seekTarget - m_source->GetFilePointer(), FILE_CURRENT);
+      PublishSource();
+      int64_t sourcePosition = m_source->GetFilePointer();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (epoch == m_epoch)
+        Drop(sourcePosition);
+      continue;
+    }
+
+    if (length == 0)
+    {
+      // The ring is full, a live stream keeps growing meanwhile
+      PublishSource();
+      std::unique_lock<std::mutex> lock(m_mutex);
+      uint64_t readCount = m_readCount.load(std::memory_order_relaxed);
+      m_spaceAvailable.wait_for(
+          lock, std::chrono::milliseconds(BUFFEREDREADER_IDLE_MAX), [this, epoch, readCount] {
+            return m_stop.load() || epoch != m_epoch ||
+                   m_readCount.load(std::memory_order_relaxed) != readCount;
+          });
+      continue;
+    }
+
+    unsigned long bytesRead = 0;
+    m_source->Read(m_block.data(), static_cast<unsigned long>(length), &bytesRead);
+
+    // The ring assumes that the source moved by what it returned, hold it to that
+    int64_t expected = position + static_cast<int64_t>(bytesRead);
+    int64_t sourcePosition = m_source->GetFilePointer();
+    if (sourcePosition != expected)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "BufferedReader: source at %lld instead of %lld, seeking back.",
+                static_cast<long long>(sourcePosition), static_cast<long long>(expected));
+      m_source->SetFilePointer(expected - sourcePosition, FILE_CURRENT);
+    }
+    if (bytesRead < length)
+      PublishSource();
+
+    if (bytesRead > 0)
+    {
+      idle = BUFFEREDREADER_IDLE_MIN;
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (epoch == m_epoch)
+      {
+        uint64_t writeCount = m_writeCount.load(std::memory_order_relaxed);
+        memcpy(&m_buffer[offset], m_block.data(), bytesRead);
+        m_writeCount.store(writeCount + bytesRead, std::memory_order_release);
+        m_dataAvailable.notify_all();
+      }
+      continue;
+    }
+
+    // No new data in the source yet, check again soon but back off while it stays empty
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_spaceAvailable.wait_for(lock, std::chrono::milliseconds(idle), [this, epoch] {
+      return m_stop.load() || epoch != m_epoch;
+    });
+    idle = std::min(idle * 2, BUFFEREDREADER_IDLE_MAX);
+  }
+}
+
+void BufferedReader::StopThread()
+{
+  if (!m_thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_spaceAvailable.notify_all();
+  m_thread.join();
+  m_stop = false;
+}
+
+void BufferedReader::Drop(int64_t sourcePosition)
+{
+  // Called with m_mutex held. Restart the ring at the offset that the source position has
+  // within a block, to keep it aligned to the file. A block in flight belongs to the old epoch.
+  uint64_t count = m_writeCount.load(std::memory_order_relaxed);
+  count += m_readSize - count % m_readSize + static_cast<uint64_t>(sourcePosition) % m_readSize;
+  m_writeCount.store(count, std::memory_order_release);
+  m_readCount.store(count, std::memory_order_release);
+  m_positionOffset.store(sourcePosition - static_cast<int64_t>(count), std::memory_order_release);
+  m_epoch++;
+}
+
+int64_t BufferedReader::SourcePosition() const
+{
+  // The source and the write count advance together, so they differ by a fixed offset
+  return static_cast<int64_t>(m_writeCount.load(std::memory_order_acquire)) +
+         m_positionOffset.load(std::memory_order_acquire);
+}
+
+void BufferedReader::PublishSource()
+{
+  m_sourceStart.store(m_source->GetStartPosition(), std::memory_order_relaxed);
+  m_sourceSize.store(m_source->GetFileSize(), std::memory_order_relaxed);
+  m_sourceInvalid = m_source->IsFileInvalid();
+}
+
+int64_t BufferedReader::SetFilePointer(int64_t llDistanceToMove, unsigned long dwMoveMethod)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t readCount = m_readCount.load(std::memory_order_relaxed);
+  int64_t offset = m_positionOffset.load(std::memory_order_relaxed);
+  int64_t position = static_cast<int64_t>(readCount) + offset;
+  int64_t sourcePosition = SourcePosition();
+  int64_t start = m_sourceStart.load(std::memory_order_relaxed);
+
+  int64_t target;
+  if (dwMoveMethod == FILE_END)
+    target = start + m_sourceSize.load(std::memory_order_relaxed) + llDistanceToMove;
+  else if (dwMoveMethod == FILE_CURRENT)
+    target = position + llDistanceToMove;
+  else // if (dwMoveMethod == FILE_BEGIN)
+    target = start + llDistanceToMove;
+  target = std::max(target, start);
+
+  if (!m_zapPending && !m_seekPending && target >= position && target <= sourcePosition)
+  {
+    // A short jump forward into the buffered data, skip to it without touching the source
+    m_readCount.store(readCount + static_cast<uint64_t>(target - position),
+                      std::memory_order_release);
+    m_spaceAvailable.notify_one();
+    m_seeksInBuffer++;
+    return target;
+  }
+
+  // The reader thread moves the source once its current read is done
+  m_seekPending = true;
+  m_seekTarget = target;
+  Drop(target);
+  m_spaceAvailable.notify_one();
+  m_seeksDropped++;
+  return target;
+}
+
+int64_t BufferedReader::GetFilePointer()
+{
+  // Does not wait for a read of the source in progress
+  return static_cast<int64_t>(m_readCount.load(std::memory_order_acquire)) +
+         m_positionOffset.load(std::memory_order_acquire);
+}
+
+int64_t BufferedReader::GetFileSize()
+{
+  return m_sourceSize.load(std::memory_order_relaxed);
+}
+
+void BufferedReader::OnZap(void)
+{
+  // The reader thread zaps the source once its current read is done, a seek before is moot
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_zapPending = true;
+  m_seekPending = false;
+  Drop(SourcePosition());
+  m_spaceAvailable.notify_one();
+}
+} // namespace ArgusTV
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (C) 2005-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "FileReader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Size of the ring buffer between the reader thread and the consumer
+#define BUFFEREDREADER_BUFFER_SIZE (4 * 1024 * 1024)
+// Largest single read from the source, reads are aligned to multiples of it
+#define BUFFEREDREADER_READ_SIZE (256 * 1024)
+// Read size for recordings, larger blocks mean fewer round trips to a file share
+#define BUFFEREDREADER_RECORDING_READ_SIZE (1024 * 1024)
+// Size of a transport stream packet, the smallest amount of data that is useful to the consumer
+#define BUFFEREDREADER_TS_PACKET_SIZE 188
+// Time in msec a Read() waits for data before it returns empty handed
+#define BUFFEREDREADER_WAIT_TIMEOUT 1000
+// Bounds in msec of the reader thread's wait when the source has no new data yet. Every poll of
+// a live timeshift buffer at its end refreshes the buffer file, keep them at the read loop's old
+// 40 and 400 msec sleeps.
+#define BUFFEREDREADER_IDLE_MIN 40
+#define BUFFEREDREADER_IDLE_MAX 400
+
+namespace ArgusTV
+{
+/**
+ * \brief Reads ahead of the consumer from another FileReader on a dedicated thread
+ *
+ * While it runs, the reader thread is the only user of the source. It reads a block into a
+ * staging buffer without holding a lock and only takes m_mutex to copy the block into the ring
+ * buffer, which Read() drains. Seeks and zaps never wait for a read of the source: they drop
+ * the ring and leave the source operation to the reader thread. Every drop starts a new epoch,
+ * a block that was read in an older epoch is thrown away. A seek to a position that is already
+ * buffered only skips ahead in the ring. The file position and size are published through
+ * atomics.
+ */
+class ATTR_DLL_LOCAL BufferedReader : public FileReader
+{
+public:
+  /**
+   * \brief Take ownership of the source and read ahead of the consumer from it
+   * \param bufferSize Number of bytes to read ahead at most
+   * \param readSize   Size of the blocks that are read from the source
+   */
+  explicit BufferedReader(FileReader* source,
+                          size_t bufferSize = BUFFEREDREADER_BUFFER_SIZE,
+                          size_t readSize = BUFFEREDREADER_READ_SIZE);
+  ~BufferedReader() override;
+
+  std::string GetFileName() const override;
+  long SetFileName(const std::string& fileName) override;
+  long OpenFile() override;
+  long CloseFile() override;
+  long Read(unsigned char* pbData, unsigned long lDataLength, unsigned long* dwReadBytes) override;
+  bool IsFileInvalid() override;
+  int64_t SetFilePointer(int64_t llDistanceToMove, unsigned long dwMoveMethod) override;
+  int64_t GetFilePointer() override;
+  int64_t GetFileSize() override;
+  void OnZap(void) override;
+  bool IsBuffer() override { return true; }
+  bool WaitForData(unsigned int timeoutMs) override;
+
+private:
+  void Process();
+  void StartThread();
+  void StopThread();
+  void Drop(int64_t sourcePosition);
+  int64_t SourcePosition() const;
+  void PublishSource();
+
+  std::unique_ptr<FileReader> m_source; // only used by the reader thread while it runs
+  // File position of ring count 0, only changed when the ring is dropped
+  std::atomic<int64_t> m_positionOffset = {0};
+  // Refreshed by the reader thread, FILE_BEGIN is relative to the start position
+  std::atomic<int64_t> m_sourceStart = {0};
+  std::atomic<int64_t> m_sourceSize = {0};
+  std::atomic<bool> m_sourceInvalid = {true};
+  size_t m_readSize;
+  unsigned int m_seeksInBuffer = 0;
+  unsigned int m_seeksDropped = 0;
+
+  std::vector<unsigned char> m_buffer;
+  std::vector<unsigned char> m_block; // staging block of the reader thread
+  std::atomic<uint64_t> m_writeCount = {0}; // changed with m_mutex held
+  std::atomic<uint64_t> m_readCount = {0}; // changed with m_mutex held
+
+  // Guards the ring layout, the epoch and the source operations left to the reader thread
+  std::mutex m_mutex;
+  uint64_t m_epoch = 0;
+  bool m_seekPending = false;
+  int64_t m_seekTarget = 0;
+  bool m_zapPending = false;
+  std::condition_variable m_dataAvailable;
+  std::condition_variable m_spaceAvailable;
+  std::atomic<bool> m_stop = {false};
+  std::thread m_thread;
+};
+} // namespace ArgusTV
@@ -48,7 +48,11 @@ public:
   virtual int64_t GetFilePointer();
   virtual void OnZap(void);
   virtual int64_t GetFileSize();
+  // Position that FILE_BEGIN seeks are relative to
+  virtual int64_t GetStartPosition() { return 0; }
   virtual bool IsBuffer() { return false; };
+  // Wait until data can be read without blocking, returns false on a timeout
+  virtual bool WaitForData(unsigned int /*timeoutMs*/) { return true; }
 
   void SetDebugOutput(bool bDebugOutput);
 
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (C) 2005-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "LocalFileReader.h"
+
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <kodi/General.h>
+
+#if defined(TARGET_WINDOWS)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ArgusTV
+{
+
+namespace
+{
+const char FILE_URL_PREFIX[] = "file://";
+} // unnamed namespace
+
+LocalFileReader::~LocalFileReader()
+{
+  CloseFile();
+}
+
+bool LocalFileReader::IsLocalPath(const std::string& fileName)
+{
+  if (fileName.compare(0, sizeof(FILE_URL_PREFIX) - 1, FILE_URL_PREFIX) == 0)
+    return true;
+#if defined(TARGET_WINDOWS)
+  return fileName.size() > 2 && isalpha(static_cast<unsigned char>(fileName[0])) &&
+         fileName[1] == ':' && (fileName[2] == '\\' || fileName[2] == '/');
+#else
+  return !fileName.empty() && fileName[0] == '/';
+#endif
+}
+
+std::string LocalFileReader::ToNativePath(const std::string& fileName)
+{
+  if (fileName.compare(0, sizeof(FILE_URL_PREFIX) - 1, FILE_URL_PREFIX) != 0)
+    return fileName;
+
+  std::string path = fileName.substr(sizeof(FILE_URL_PREFIX) - 1);
+#if defined(TARGET_WINDOWS)
+  // file:///C:/dir/file.ts
+  if (path.size() > 2 && path[0] == '/' && path[2] == ':')
+    path.erase(0, 1);
+#endif
+  return path;
+}
+
+long LocalFileReader::OpenFile()
+{
+  if (!IsFileInvalid())
+  {
+    kodi::Log(ADDON_LOG_INFO, "LocalFileReader::OpenFile() file already open");
+    return S_OK;
+  }
+
+  std::string path = ToNativePath(m_fileName);
+#if defined(TARGET_WINDOWS)
+  m_fd = _open(path.c_str(), _O_RDONLY | _O_BINARY | _O_SEQUENTIAL);
+#else
+  m_fd = open(path.c_str(), O_RDONLY);
+#endif
+  if (m_fd == -1)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "LocalFileReader::OpenFile(), open file %s failed (error %d).",
+              path.c_str(), errno);
+    return S_FALSE;
+  }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_RDAHEAD)
+  fcntl(m_fd, F_RDAHEAD, 1);
+#endif
+
+  m_position = 0;
+  kodi::Log(ADDON_LOG_DEBUG, "%s: OpenFile(%s) succeeded.", __FUNCTION__, path.c_str());
+  return S_OK;
+}
+
+long LocalFileReader::CloseFile()
+{
+  if (IsFileInvalid())
+    return S_OK;
+
+#if defined(TARGET_WINDOWS)
+  _close(m_fd);
+#else
+  close(m_fd);
+#endif
+  m_fd = -1;
+  return S_OK;
+}
+
+bool LocalFileReader::IsFileInvalid()
+{
+  return m_fd == -1;
+}
+
+long LocalFileReader::Read(unsigned char* pbData,
+                           unsigned long lDataLength,
+                           unsigned long* dwReadBytes)
+{
+  *dwReadBytes = 0;
+  if (IsFileInvalid())
+    return S_FALSE;
+
+#if defined(TARGET_WINDOWS)
+  if (_lseeki64(m_fd, m_position, SEEK_SET) != m_position)
+    return S_FALSE;
+#endif
+  while (*dwReadBytes < lDataLength)
+  {
+#if defined(TARGET_WINDOWS)
+    int bytesRead = _read(m_fd, pbData + *dwReadBytes, lDataLength - *dwReadBytes);
+#else
+    ssize_t bytesRead =
+        pread(m_fd, pbData + *dwReadBytes, lDataLength - *dwReadBytes, m_position);
+#endif
+    if (bytesRead < 0 && errno == EINTR)
+      continue;
+    if (bytesRead <= 0)
+      break;
+    *dwReadBytes += static_cast<unsigned long>(bytesRead);
+    m_position += bytesRead;
+  }
+
+  if (*dwReadBytes < lDataLength)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "LocalFileReader::Read() read too less bytes");
+    return S_FALSE;
+  }
+  return S_OK;
+}
+
+int64_t LocalFileReader::SetFilePointer(int64_t llDistanceToMove, unsigned long dwMoveMethod)
+{
+  if (dwMoveMethod == FILE_END)
+    m_position = GetFileSize() + llDistanceToMove;
+  else if (dwMoveMethod == FILE_CURRENT)
+    m_position += llDistanceToMove;
+  else // if (dwMoveMethod == FILE_BEGIN)
+    m_position = llDistanceToMove;
+
+  if (m_position < 0)
+    m_position = 0;
+  return m_position;
+}
+
+int64_t LocalFileReader::GetFilePointer()
+{
+  return m_position;
+}
+
+int64_t LocalFileReader::GetFileSize()
+{
+  if (IsFileInvalid())
+    return 0;
+
+#if defined(TARGET_WINDOWS)
+  struct _stati64 buf;
+  if (_fstati64(m_fd, &buf) != 0)
+    return 0;
+#else
+  struct stat buf;
+  if (fstat(m_fd, &buf) != 0)
+    return 0;
+#endif
+  return static_cast<int64_t>(buf.st_size);
+}
+} // namespace ArgusTV
@@ -0,0 +1,48 @@
+/*
+ *  Copyright (C) 2005-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "FileReader.h"
+
+namespace ArgusTV
+{
+/**
+ * \brief Reads a file on a local or locally mounted filesystem without Kodi's VFS
+ *
+ * Uses positioned reads on a plain file descriptor and tells the OS that the file is read
+ * sequentially, so that it reads ahead generously.
+ */
+class ATTR_DLL_LOCAL LocalFileReader : public FileReader
+{
+public:
+  LocalFileReader() = default;
+  ~LocalFileReader() override;
+
+  /**
+   * \brief Whether a file name is a local path (absolute path, drive letter or file:// url)
+   */
+  static bool IsLocalPath(const std::string& fileName);
+
+  /**
+   * \brief Convert a local path or file:// url into a path for the OS file functions
+   */
+  static std::string ToNativePath(const std::string& fileName);
+
+  long OpenFile() override;
+  long CloseFile() override;
+  long Read(unsigned char* pbData, unsigned long lDataLength, unsigned long* dwReadBytes) override;
+  bool IsFileInvalid() override;
+  int64_t SetFilePointer(int64_t llDistanceToMove, unsigned long dwMoveMethod) override;
+  int64_t GetFilePointer() override;
+  int64_t GetFileSize() override;
+
+private:
+  int m_fd = -1;
+  int64_t m_position = 0;
+};
+} // namespace ArgusTV
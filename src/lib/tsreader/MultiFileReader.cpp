@@ -25,9 +25,12 @@
 
 #include "MultiFileReader.h"
 
+#include "LocalFileReader.h"
 #include "utils.h"
 
 #include <algorithm>
+#include <cstring>
+#include <functional>
 #include <limits.h>
 #include <string>
 #include <thread>
@@ -36,12 +39,42 @@
 #include <kodi/General.h>
 #include <kodi/tools/EndTime.h>
 
+//Maximum time in msec to wait for the server to write the first bytes of the buffer file
+#define BUFFER_FILE_TIMEOUT 10000
 //Maximum time in msec to wait for the buffer file to become available - Needed for DVB radio (this sometimes takes some time)
 #define MAX_BUFFER_TIMEOUT 1500
+//Bounds in msec of the wait between two readiness checks, it doubles after every check
+#define READINESS_WAIT_MIN 5
+#define READINESS_WAIT_MAX 200
+//Maximum time in msec between two checks of the buffer file while reading well before its end
+#define TSBUFFER_REFRESH_INTERVAL 1000
+//Maximum number of segment files kept open at the same time
+#define SEGMENT_HANDLE_CACHE_SIZE 4
 
 namespace ArgusTV
 {
 
+namespace
+{
+// Check ready() until it returns true, waiting a little longer after every failed check
+bool WaitUntilReady(const std::function<bool()>& ready, unsigned int timeoutMs, int& checks)
+{
+  kodi::tools::CEndTime timeout(timeoutMs);
+  unsigned int wait = READINESS_WAIT_MIN;
+  checks = 1;
+  while (!ready())
+  {
+    unsigned int left = static_cast<unsigned int>(timeout.MillisLeft());
+    if (left == 0)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(wait, left)));
+    wait = std::min(wait * 2, static_cast<unsigned int>(READINESS_WAIT_MAX));
+    checks++;
+  }
+  return true;
+}
+} // unnamed namespace
+
 std::string MultiFileReader::GetFileName() const
 {
   //  CheckPointer(lpszFileName,E_POINTER);
@@ -68,46 +101,37 @@ long MultiFileReader::OpenFile()
     return S_FALSE;
   }
 
-  int64_t fileLength = stat.GetSize();
-  kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: buffer file %s, stat.size %ld.",
-            bufferfilename.c_str(), fileLength);
+  // The server creates the buffer file before it writes to it
+  int checks = 0;
+  if (stat.GetSize() == 0)
+  {
+    WaitUntilReady(
+        [&bufferfilename, &stat] {
+          return kodi::vfs::StatFile(bufferfilename, stat) && stat.GetSize() > 0;
+        },
+        BUFFER_FILE_TIMEOUT, checks);
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: buffer file %s, after %d checks stat.size is %ld.",
+            bufferfilename.c_str(), checks, stat.GetSize());
 
-  int retryCount = 0;
-  if (fileLength == 0)
-    do
-    {
-      retryCount++;
-      kodi::Log(ADDON_LOG_DEBUG,
-                "MultiFileReader: buffer file has zero length, closing, waiting 500 ms and "
-                "re-opening. Try %d.",
-                retryCount);
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
-      kodi::vfs::StatFile(bufferfilename, stat);
-      fileLength = stat.GetSize();
-    } while (fileLength == 0 && retryCount < 20);
-  kodi::Log(ADDON_LOG_DEBUG,
-            "MultiFileReader: buffer file %s, after %d retries stat.size returns %ld.",
-            bufferfilename.c_str(), retryCount, fileLength);
+  m_openTime = std::chrono::steady_clock::now();
+  m_refreshCount = 0;
+  m_refreshSkipped = 0;
+  m_fileOperations = 0;
 
   long hr = m_TSBufferFile.OpenFile();
 
-  if (RefreshTSBufferFile() == S_FALSE)
+  // For radio the buffer sometimes needs some time to become available
+  if (!WaitUntilReady([this] { return RefreshTSBufferFile() != S_FALSE; }, MAX_BUFFER_TIMEOUT,
+                      checks))
   {
-    // For radio the buffer sometimes needs some time to become available, so wait and try it more than once
-    kodi::tools::CEndTime timeout(MAX_BUFFER_TIMEOUT);
-
-    do
-    {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      if (timeout.MillisLeft() == 0)
-      {
-        kodi::Log(ADDON_LOG_ERROR,
-                  "MultiFileReader: timed out while waiting for buffer file to become available");
-        kodi::QueueNotification(QUEUE_ERROR, "", "Time out while waiting for buffer file");
-        return S_FALSE;
-      }
-    } while (RefreshTSBufferFile() == S_FALSE);
+    kodi::Log(ADDON_LOG_ERROR,
+              "MultiFileReader: timed out while waiting for buffer file to become available");
+    kodi::QueueNotification(QUEUE_ERROR, "", "Time out while waiting for buffer file");
+    return S_FALSE;
   }
+  if (checks > 1)
+    kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: buffer file available after %d checks.", checks);
 
   m_currentReadPosition = 0;
 
@@ -119,15 +143,16 @@ long MultiFileReader::OpenFile()
 //
 long MultiFileReader::CloseFile()
 {
+  if (!m_TSBufferFile.IsFileInvalid())
+    LogStatistics();
+
   long hr;
   hr = m_TSBufferFile.CloseFile();
-  hr = m_TSFile.CloseFile();
-  std::vector<MultiFileReaderFile*>::iterator it;
-  for (it = m_tsFiles.begin(); it < m_tsFiles.end(); it++)
-  {
-    delete (*it);
-  }
-  m_TSFileId = 0;
+  CloseSegments(LONG_MAX);
+  m_tsFiles.clear();
+  m_currentFile = 0;
+  m_filesAdded = 0;
+  m_filesRemoved = 0;
   return hr;
 }
 
@@ -138,7 +163,14 @@ bool MultiFileReader::IsFileInvalid()
 
 int64_t MultiFileReader::SetFilePointer(int64_t llDistanceToMove, unsigned long dwMoveMethod)
 {
-  RefreshTSBufferFile();
+  // A seek to the end wants the newest end position, other seeks only when they leave the known
+  // range or the files may have changed meanwhile
+  if (dwMoveMethod == FILE_END ||
+      RefreshNeeded(dwMoveMethod == FILE_CURRENT ? m_currentReadPosition + llDistanceToMove
+                                                 : m_startPosition + llDistanceToMove))
+    RefreshTSBufferFile();
+  else
+    m_refreshSkipped++;
 
   if (dwMoveMethod == FILE_END)
   {
@@ -183,7 +215,10 @@ long MultiFileReader::Read(unsigned char* pbData,
   if (m_TSBufferFile.IsFileInvalid())
     return S_FALSE;
 
-  RefreshTSBufferFile();
+  if (RefreshNeeded(m_currentReadPosition + lDataLength))
+    RefreshTSBufferFile();
+  else
+    m_refreshSkipped++;
 
   if (m_currentReadPosition < m_startPosition)
   {
@@ -192,89 +227,59 @@ long MultiFileReader::Read(unsigned char* pbData,
     m_currentReadPosition = m_startPosition;
   }
 
-  // Find out which file the currentPosition is in.
-  MultiFileReaderFile* file = nullptr;
-  std::vector<MultiFileReaderFile*>::iterator it = m_tsFiles.begin();
-  for (; it < m_tsFiles.end(); it++)
-  {
-    file = *it;
-    if (m_currentReadPosition < (file->startPosition + file->length))
-      break;
-  };
-
-  // kodi::Log(ADDON_LOG_DEBUG, "%s: reading %ld bytes. File %s, start %d, current %d, end %d.", __FUNCTION__, lDataLength, file->filename.c_str(), m_startPosition, m_currentPosition, m_endPosition);
-
-
-  if (!file)
+  if (m_tsFiles.empty())
   {
     kodi::Log(ADDON_LOG_ERROR, "MultiFileReader::no file");
     kodi::QueueNotification(QUEUE_ERROR, "", "No buffer file");
     return S_FALSE;
   }
-  if (m_currentReadPosition < (file->startPosition + file->length))
+
+  // Read file by file until the request is satisfied or the end of the last file is reached
+  *dwReadBytes = 0;
+  unsigned long offset = 0;
+  while (offset < lDataLength)
   {
-    if (m_TSFileId != file->filePositionId)
+    // Find out which file the currentPosition is in.
+    const MultiFileReaderFile* file = FindFile(m_currentReadPosition);
+    if (!file)
     {
-      m_TSFile.CloseFile();
-      m_TSFile.SetFileName(file->filename.c_str());
-      m_TSFile.OpenFile();
+      // The current position is past the end of the last file
+      break;
+    }
 
-      m_TSFileId = file->filePositionId;
+    // kodi::Log(ADDON_LOG_DEBUG, "%s: reading %ld bytes. File %s, start %d, current %d, end %d.", __FUNCTION__, lDataLength, file->filename.c_str(), m_startPosition, m_currentPosition, m_endPosition);
 
-      if (m_bDebugOutput)
-      {
-        kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader::Read() Current File Changed to %s\n",
-                  file->filename.c_str());
-      }
-    }
+    FileReader& segment = GetSegmentReader(*file);
 
     int64_t seekPosition = m_currentReadPosition - file->startPosition;
 
-    int64_t posSeeked = m_TSFile.GetFilePointer();
+    int64_t posSeeked = segment.GetFilePointer();
     if (posSeeked != seekPosition)
     {
-      m_TSFile.SetFilePointer(seekPosition, FILE_BEGIN);
-      posSeeked = m_TSFile.GetFilePointer();
+      segment.SetFilePointer(seekPosition, FILE_BEGIN);
+      m_fileOperations++;
+      posSeeked = segment.GetFilePointer();
       if (posSeeked != seekPosition)
       {
         kodi::Log(ADDON_LOG_ERROR, "SEEK FAILED");
       }
     }
 
+    unsigned long bytesToRead = static_cast<unsigned long>(
+        std::min<int64_t>(lDataLength - offset, file->length - seekPosition));
     unsigned long bytesRead = 0;
-
-    int64_t bytesToRead = file->length - seekPosition;
-    if ((int64_t)lDataLength > bytesToRead)
-    {
-      // kodi::Log(ADDON_LOG_DEBUG, "%s: datalength %lu bytesToRead %lli.", __FUNCTION__, lDataLength, bytesToRead);
-      hr = m_TSFile.Read(pbData, (unsigned long)bytesToRead, &bytesRead);
-      if (FAILED(hr))
-      {
-        kodi::Log(ADDON_LOG_ERROR, "READ FAILED1");
-      }
-      m_currentReadPosition += bytesToRead;
-
-      hr = this->Read(pbData + bytesToRead, lDataLength - (unsigned long)bytesToRead, dwReadBytes);
-      if (FAILED(hr))
-      {
-        kodi::Log(ADDON_LOG_ERROR, "READ FAILED2");
-      }
-      *dwReadBytes += bytesRead;
-    }
-    else
+    hr = segment.Read(pbData + offset, bytesToRead, &bytesRead);
+    m_fileOperations++;
+    if (FAILED(hr))
     {
-      hr = m_TSFile.Read(pbData, lDataLength, dwReadBytes);
-      if (FAILED(hr))
-      {
-        kodi::Log(ADDON_LOG_ERROR, "READ FAILED3");
-      }
-      m_currentReadPosition += lDataLength;
+      kodi::Log(ADDON_LOG_ERROR, "READ FAILED");
     }
-  }
-  else
-  {
-    // The current position is past the end of the last file
-    *dwReadBytes = 0;
+    // Advance by what was read, a short read leaves the rest of the segment for the next call
+    m_currentReadPosition += bytesRead;
+    offset += bytesRead;
+    *dwReadBytes += bytesRead;
+    if (bytesRead < bytesToRead)
+      break;
   }
 
   // kodi::Log(ADDON_LOG_DEBUG, "%s: read %lu bytes. start %lli, current %lli, end %lli.", __FUNCTION__, *dwReadBytes, m_startPosition, m_currentPosition, m_endPosition);
@@ -287,8 +292,10 @@ long MultiFileReader::RefreshTSBufferFile()
   if (m_TSBufferFile.IsFileInvalid())
     return S_FALSE;
 
+  m_lastRefresh = std::chrono::steady_clock::now();
+  m_refreshCount++;
+
   unsigned long bytesRead;
-  MultiFileReaderFile* file;
 
   long result;
   int64_t currentPosition;
@@ -297,7 +304,11 @@ long MultiFileReader::RefreshTSBufferFile()
   long Error = 0;
   long Loop = 10;
 
-  Wchar_t* pBuffer = nullptr;
+  // Layout: Header ( int64_t + int32_t + int32_t ) + filelist + Footer ( int32_t + int32_t )
+  const size_t headerLength = sizeof(currentPosition) + sizeof(filesAdded) + sizeof(filesRemoved);
+  const size_t footerLength = sizeof(filesAdded2) + sizeof(filesRemoved2);
+  size_t fileListLength = 0;
+
   do
   {
     Error = 0;
@@ -307,12 +318,13 @@ long MultiFileReader::RefreshTSBufferFile()
     filesAdded2 = -2;
     filesRemoved2 = -2;
 
-    int64_t fileLength = m_TSBufferFile.GetFileSize();
+    // Most refreshes find the same files, so read only the header first
+    unsigned char header[headerLength];
+    m_TSBufferFile.SetFilePointer(0, FILE_BEGIN);
+    result = m_TSBufferFile.Read(header, (unsigned long)headerLength, &bytesRead);
+    m_fileOperations += 2;
 
-    // Min file length is Header ( int64_t + int32_t + int32_t ) + filelist ( > 0 ) + Footer ( int32_t + int32_t )
-    if (fileLength <=
-        (int64_t)(sizeof(currentPosition) + sizeof(filesAdded) + sizeof(filesRemoved) +
-                  sizeof(wchar_t) + sizeof(filesAdded2) + sizeof(filesRemoved2)))
+    if (SUCCEEDED(result) && bytesRead < headerLength)
     {
       if (m_bDebugOutput)
       {
@@ -320,59 +332,61 @@ long MultiFileReader::RefreshTSBufferFile()
       }
       return S_FALSE;
     }
-
-    m_TSBufferFile.SetFilePointer(0, FILE_BEGIN);
-
-    uint32_t readLength = sizeof(currentPosition) + sizeof(filesAdded) + sizeof(filesRemoved);
-    unsigned char* readBuffer = new unsigned char[readLength];
-
-    result = m_TSBufferFile.Read(readBuffer, readLength, &bytesRead);
-
-    if (!SUCCEEDED(result) || bytesRead != readLength)
+    if (!SUCCEEDED(result))
       Error |= 0x02;
 
     if (Error == 0)
     {
-      currentPosition = *((int64_t*)(readBuffer + 0));
-      filesAdded = *((int32_t*)(readBuffer + sizeof(currentPosition)));
-      filesRemoved = *((int32_t*)(readBuffer + sizeof(currentPosition) + sizeof(filesAdded)));
-    }
-
-    delete[] readBuffer;
-
-    // If no files added or removed, break the loop !
-    if ((m_filesAdded == filesAdded) && (m_filesRemoved == filesRemoved))
-      break;
-
-    int64_t remainingLength = fileLength - sizeof(currentPosition) - sizeof(filesAdded) -
-                              sizeof(filesRemoved) - sizeof(filesAdded2) - sizeof(filesRemoved2);
+      // The buffer has no particular alignment, so copy the numbers out of it
+      memcpy(&currentPosition, header, sizeof(currentPosition));
+      memcpy(&filesAdded, header + sizeof(currentPosition), sizeof(filesAdded));
+      memcpy(&filesRemoved, header + sizeof(currentPosition) + sizeof(filesAdded),
+             sizeof(filesRemoved));
 
-    // Above 100kb seems stupid and figure out a problem !!!
-    if (remainingLength > 100000)
-      Error |= 0x10;
+      // If no files added or removed, break the loop !
+      if ((m_filesAdded == filesAdded) && (m_filesRemoved == filesRemoved))
+        break;
 
-    pBuffer = (Wchar_t*)new char[(unsigned int)remainingLength];
+      int64_t fileLength = m_TSBufferFile.GetFileSize();
+      m_fileOperations++;
 
-    result = m_TSBufferFile.Read((unsigned char*)pBuffer, (uint32_t)remainingLength, &bytesRead);
-    if (!SUCCEEDED(result) || (int64_t)bytesRead != remainingLength)
-      Error |= 0x20;
-
-    readLength = sizeof(filesAdded) + sizeof(filesRemoved);
-
-    readBuffer = new unsigned char[readLength];
+      // Min file length is Header + filelist ( > 0 ) + Footer
+      if (fileLength <= (int64_t)(headerLength + sizeof(Wchar_t) + footerLength))
+      {
+        if (m_bDebugOutput)
+        {
+          kodi::Log(ADDON_LOG_DEBUG,
+                    "MultiFileReader::RefreshTSBufferFile() TSBufferFile too short");
+        }
+        return S_FALSE;
+      }
 
-    result = m_TSBufferFile.Read(readBuffer, readLength, &bytesRead);
+      fileListLength = (size_t)fileLength - headerLength - footerLength;
 
-    if (!SUCCEEDED(result) || bytesRead != readLength)
-      Error |= 0x40;
+      // Above 100kb seems stupid and figure out a problem !!!
+      if (fileListLength > 100000)
+        Error |= 0x10;
+    }
 
     if (Error == 0)
     {
-      filesAdded2 = *((int32_t*)(readBuffer + 0));
-      filesRemoved2 = *((int32_t*)(readBuffer + sizeof(filesAdded2)));
+      // The files changed, read the file list and the footer behind the header into the reused
+      // buffer
+      m_bufferFileData.resize(fileListLength + footerLength);
+      result = m_TSBufferFile.Read(m_bufferFileData.data(), (unsigned long)m_bufferFileData.size(),
+                                   &bytesRead);
+      m_fileOperations++;
+
+      if (!SUCCEEDED(result) || bytesRead != m_bufferFileData.size())
+        Error |= 0x20;
     }
 
-    delete[] readBuffer;
+    if (Error == 0)
+    {
+      const unsigned char* footer = m_bufferFileData.data() + fileListLength;
+      memcpy(&filesAdded2, footer, sizeof(filesAdded2));
+      memcpy(&filesRemoved2, footer + sizeof(filesAdded2), sizeof(filesRemoved2));
+    }
 
     if ((filesAdded2 != filesAdded) || (filesRemoved2 != filesRemoved))
     {
@@ -388,12 +402,10 @@ long MultiFileReader::RefreshTSBufferFile()
       // try to clear local / remote SMB file cache. This should happen when we close the filehandle
       m_TSBufferFile.CloseFile();
       m_TSBufferFile.OpenFile();
+      m_fileOperations += 2;
       std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
 
-    if (Error)
-      delete[] pBuffer;
-
     Loop--;
   } while (Error && Loop); // If Error is set, try again...until Loop reaches 0.
 
@@ -424,117 +436,78 @@ long MultiFileReader::RefreshTSBufferFile()
     }
 
     // Removed files that aren't present anymore.
-    while ((filesToRemove > 0) && (m_tsFiles.size() > 0))
+    long removeCount = std::min<long>(std::max<long>(filesToRemove, 0), m_tsFiles.size());
+    for (long i = 0; i < removeCount; i++)
     {
-      MultiFileReaderFile* file = m_tsFiles.at(0);
-
       if (m_bDebugOutput)
       {
-        kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: Removing file %s\n", file->filename.c_str());
+        kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: Removing file %s\n",
+                  m_tsFiles[i].filename.c_str());
       }
-
-      delete file;
-      m_tsFiles.erase(m_tsFiles.begin());
-
-      filesToRemove--;
     }
-
+    m_tsFiles.erase(m_tsFiles.begin(), m_tsFiles.begin() + removeCount);
+    m_currentFile -= std::min<size_t>(m_currentFile, removeCount);
+    // The remaining files have ids above filesRemoved, close the handles of the others
+    CloseSegments(filesRemoved);
 
     // Figure out what the start position of the next new file will be
     if (m_tsFiles.size() > 0)
     {
-      file = m_tsFiles.back();
+      MultiFileReaderFile& file = m_tsFiles.back();
 
       if (filesToAdd > 0)
       {
         // If we're adding files the changes are the one at the back has a partial length
         // so we need update it.
-        GetFileLength(file->filename.c_str(), file->length);
+        GetFileLength(file.filename, file.length);
       }
 
-      nextStartPosition = file->startPosition + file->length;
+      nextStartPosition = file.startPosition + file.length;
     }
 
     // Get the real path of the buffer file
-    std::string sFilename;
-    std::string path;
-    size_t pos = std::string::npos;
-
-    sFilename = m_TSBufferFile.GetFileName();
-    pos = sFilename.find_last_of('/');
-    path = sFilename.substr(0, pos + 1);
-    //name3 = filename1.substr(pos+1);
-
-    // Create a list of files in the .tsbuffer file.
-    std::vector<std::string> filenames;
-
-    Wchar_t* pwCurrFile = pBuffer; //Get a pointer to the first wchar filename string in pBuffer
-    long length = WcsLen(pwCurrFile);
-
-    //kodi::Log(ADDON_LOG_DEBUG, "%s: WcsLen(%d), sizeof(wchar_t) == %d.", __FUNCTION__, length, sizeof(wchar_t));
-
-    while (length > 0)
+    std::string sFilename = m_TSBufferFile.GetFileName();
+    size_t pos = sFilename.find_last_of('/');
+    std::string path = sFilename.substr(0, pos + 1);
+
+    // The file list holds zero terminated 2-byte character strings and ends with an empty one.
+    // The names of the files we already know are skipped, only the new ones are converted.
+    const unsigned char* pwCurrFile = m_bufferFileData.data();
+    const unsigned char* pwEnd = pwCurrFile + fileListLength;
+    size_t knownFiles = m_tsFiles.size();
+    size_t fileIndex = 0;
+    std::string sCurrFile;
+
+    while (pwCurrFile + sizeof(Wchar_t) <= pwEnd)
     {
       // Convert the current filename (wchar to normal char)
-      char* wide2normal = new char[length + 1];
-      WcsToMbs(wide2normal, pwCurrFile, length);
-      wide2normal[length] = '\0';
-
-      //unsigned char* pb = (unsigned char*) wide2normal;
-      //for (unsigned long i = 0; i < rc; i++)
-      //{
-      //  kodi::Log(ADDON_LOG_DEBUG, "%s: pBuffer byte[%d] == %x.", __FUNCTION__, i, pb[i]);
-      //}
-
-      std::string sCurrFile = wide2normal;
-      //kodi::Log(ADDON_LOG_DEBUG, "%s: filename %s (%s).", __FUNCTION__, wide2normal, sCurrFile.c_str());
-      delete[] wide2normal;
-
-      // Modify filename path here to include the real (local) path
-      pos = sCurrFile.find_last_of(92);
-      std::string name = sCurrFile.substr(pos + 1);
-      if (path.length() > 0 && name.length() > 0)
+      sCurrFile.clear();
+      size_t length = 0;
+      Wchar_t wc;
+      while (pwCurrFile + sizeof(Wchar_t) <= pwEnd)
       {
-        // Replace the original path with our local path
-        filenames.push_back(path + name);
+        memcpy(&wc, pwCurrFile, sizeof(wc));
+        pwCurrFile += sizeof(wc);
+        if (wc == 0)
+          break;
+        length++;
+        if (fileIndex >= knownFiles)
+          sCurrFile += static_cast<char>(wc);
       }
-      else
-      {
-        // Keep existing path
-        filenames.push_back(sCurrFile);
-      }
-
-      // Move the wchar buffer pointer to the next wchar string
-      pwCurrFile += (length + 1);
-      length = WcsLen(pwCurrFile);
-    }
-
-    // Go through files
-    std::vector<MultiFileReaderFile*>::iterator itFiles = m_tsFiles.begin();
-    //std::vector<char*>::iterator itFilenames = filenames.begin();
-    std::vector<std::string>::iterator itFilenames = filenames.begin();
-
-    while (itFiles < m_tsFiles.end())
-    {
-      file = *itFiles;
-
-      itFiles++;
-      fileID++;
-
-      if (itFilenames < filenames.end())
+      if (length == 0)
+        break;
+      if (fileIndex++ < knownFiles)
       {
         // TODO: Check that the filenames match. ( Ambass : With buffer integrity check, probably no need to do this !)
-        itFilenames++;
-      }
-      else
-      {
-        kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: Missing files!!\n");
+        continue;
       }
-    }
 
-    while (itFilenames < filenames.end())
-    {
-      std::string pFilename = *itFilenames;
+      // Modify filename path here to include the real (local) path
+      pos = sCurrFile.find_last_of(92);
+      std::string name = sCurrFile.substr(pos + 1);
+      std::string pFilename = (path.length() > 0 && name.length() > 0)
+                                  ? path + name // Replace the original path with our local path
+                                  : sCurrFile; // Keep existing path
 
       if (m_bDebugOutput)
       {
@@ -543,32 +516,27 @@ long MultiFileReader::RefreshTSBufferFile()
                   nextStPos);
       }
 
-      file = new MultiFileReaderFile();
-      file->filename = pFilename;
-      file->startPosition = nextStartPosition;
-
-      fileID++;
-      file->filePositionId = fileID;
-
-      GetFileLength(file->filename, file->length);
+      MultiFileReaderFile file;
+      file.filename = pFilename;
+      file.startPosition = nextStartPosition;
+      file.filePositionId = fileID + (long)fileIndex;
 
-      m_tsFiles.push_back(file);
+      GetFileLength(file.filename, file.length);
 
-      nextStartPosition = file->startPosition + file->length;
-
-      itFilenames++;
+      nextStartPosition = file.startPosition + file.length;
+      m_tsFiles.push_back(std::move(file));
     }
 
+    if (fileIndex < knownFiles)
+      kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader: Missing files!!\n");
+
     m_filesAdded = filesAdded;
     m_filesRemoved = filesRemoved;
-
-    delete[] pBuffer;
   }
 
   if (m_tsFiles.size() > 0)
   {
-    file = m_tsFiles.front();
-    m_startPosition = file->startPosition;
+    m_startPosition = m_tsFiles.front().startPosition;
     // Since the buffer file may be re-used when a channel is changed, we
     // want the start position to reflect the position in the file after the last
     // channel change, or the real start position, whichever is larger
@@ -577,9 +545,9 @@ long MultiFileReader::RefreshTSBufferFile()
       m_startPosition = m_lastZapPosition;
     }
 
-    file = m_tsFiles.back();
-    file->length = currentPosition;
-    m_endPosition = file->startPosition + currentPosition;
+    MultiFileReaderFile& file = m_tsFiles.back();
+    file.length = currentPosition;
+    m_endPosition = file.startPosition + currentPosition;
 
     if (m_bDebugOutput)
     {
@@ -599,9 +567,115 @@ long MultiFileReader::RefreshTSBufferFile()
   return S_OK;
 }
 
+const MultiFileReaderFile* MultiFileReader::FindFile(int64_t position)
+{
+  // Sequential reads stay in the same file most of the time
+  if (m_currentFile < m_tsFiles.size())
+  {
+    const MultiFileReaderFile& file = m_tsFiles[m_currentFile];
+    if (file.startPosition <= position && position < file.startPosition + file.length)
+      return &file;
+  }
+
+  // The files are contiguous, so they are sorted by their start as well as their end position
+  auto it = std::upper_bound(m_tsFiles.begin(), m_tsFiles.end(), position,
+                             [](int64_t pos, const MultiFileReaderFile& file) {
+                               return pos < file.startPosition + file.length;
+                             });
+  if (it == m_tsFiles.end())
+    return nullptr;
+
+  m_currentFile = static_cast<size_t>(it - m_tsFiles.begin());
+  return &*it;
+}
+
+FileReader& MultiFileReader::GetSegmentReader(const MultiFileReaderFile& file)
+{
+  m_segmentUseCount++;
+  for (SegmentHandle& handle : m_segmentHandles)
+  {
+    if (handle.filePositionId == file.filePositionId)
+    {
+      handle.lastUse = m_segmentUseCount;
+      return *handle.reader;
+    }
+  }
+
+  // Make room by closing the least recently used handle
+  if (m_segmentHandles.size() >= SEGMENT_HANDLE_CACHE_SIZE)
+  {
+    auto lru = std::min_element(
+        m_segmentHandles.begin(), m_segmentHandles.end(),
+        [](const SegmentHandle& a, const SegmentHandle& b) { return a.lastUse < b.lastUse; });
+    lru->reader->CloseFile();
+    m_fileOperations++;
+    m_segmentHandles.erase(lru);
+  }
+
+  SegmentHandle handle;
+  handle.filePositionId = file.filePositionId;
+  handle.lastUse = m_segmentUseCount;
+  if (LocalFileReader::IsLocalPath(file.filename))
+    handle.reader.reset(new LocalFileReader());
+  else
+    handle.reader.reset(new FileReader());
+  handle.reader->SetFileName(file.filename);
+  handle.reader->OpenFile();
+  m_fileOperations++;
+
+  if (m_bDebugOutput)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "MultiFileReader::Read() Current File Changed to %s\n",
+              file.filename.c_str());
+  }
+
+  m_segmentHandles.push_back(std::move(handle));
+  return *m_segmentHandles.back().reader;
+}
+
+void MultiFileReader::CloseSegments(long maxFilePositionId)
+{
+  for (auto it = m_segmentHandles.begin(); it != m_segmentHandles.end();)
+  {
+    if (it->filePositionId <= maxFilePositionId)
+    {
+      it->reader->CloseFile();
+      m_fileOperations++;
+      it = m_segmentHandles.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+bool MultiFileReader::RefreshNeeded(int64_t readEndPosition) const
+{
+  // Near the end new data may have been written, further away only files may have been removed
+  return m_tsFiles.empty() || readEndPosition > m_endPosition ||
+         std::chrono::steady_clock::now() - m_lastRefresh >=
+             std::chrono::milliseconds(TSBUFFER_REFRESH_INTERVAL);
+}
+
+void MultiFileReader::LogStatistics() const
+{
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - m_openTime);
+  int64_t seconds = std::max<int64_t>(1, duration.count() / 1000);
+  kodi::Log(ADDON_LOG_INFO,
+            "MultiFileReader: %llu buffer file refreshes, %llu skipped, %llu file operations in "
+            "%lld seconds (%lld per second).",
+            static_cast<unsigned long long>(m_refreshCount),
+            static_cast<unsigned long long>(m_refreshSkipped),
+            static_cast<unsigned long long>(m_fileOperations), static_cast<long long>(seconds),
+            static_cast<long long>(m_fileOperations / seconds));
+}
+
 long MultiFileReader::GetFileLength(const std::string& filename, int64_t& length)
 {
   length = 0;
+  m_fileOperations++;
   kodi::vfs::FileStatus stat;
   if (!kodi::vfs::StatFile(filename, stat))
   {
@@ -616,7 +690,10 @@ long MultiFileReader::GetFileLength(const std::string& filename, int64_t& length
 
 int64_t MultiFileReader::GetFileSize()
 {
-  RefreshTSBufferFile();
+  if (RefreshNeeded(m_endPosition))
+    RefreshTSBufferFile();
+  else
+    m_refreshSkipped++;
   return m_endPosition - m_startPosition;
 }
 
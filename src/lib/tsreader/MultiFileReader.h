@@ -27,6 +27,8 @@
 
 #include "FileReader.h"
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -57,11 +59,17 @@ public:
   int64_t SetFilePointer(int64_t llDistanceToMove, unsigned long dwMoveMethod) override;
   int64_t GetFilePointer() override;
   int64_t GetFileSize() override;
+  int64_t GetStartPosition() override { return m_startPosition; }
   void OnZap(void) override;
 
 protected:
   long RefreshTSBufferFile();
+  bool RefreshNeeded(int64_t readEndPosition) const;
+  const MultiFileReaderFile* FindFile(int64_t position);
+  FileReader& GetSegmentReader(const MultiFileReaderFile& file);
+  void CloseSegments(long maxFilePositionId);
   long GetFileLength(const std::string& filename, int64_t& length);
+  void LogStatistics() const;
 
   FileReader m_TSBufferFile;
   int64_t m_startPosition = 0;
@@ -71,11 +79,28 @@ protected:
   long m_filesRemoved = 0;
   int64_t m_lastZapPosition = 0;
 
-  std::vector<MultiFileReaderFile*> m_tsFiles;
+  std::vector<MultiFileReaderFile> m_tsFiles; // sorted by startPosition, without gaps
+  size_t m_currentFile = 0; // index of the file of the last read, checked first
+  std::vector<unsigned char> m_bufferFileData; // file list and footer of the buffer file, reused
 
-  FileReader m_TSFile;
-  long m_TSFileId = 0;
+  // Open segment files, so that seeking back and forth does not reopen them every time
+  struct SegmentHandle
+  {
+    long filePositionId = 0;
+    uint64_t lastUse = 0;
+    std::unique_ptr<FileReader> reader;
+  };
+  std::vector<SegmentHandle> m_segmentHandles;
+  uint64_t m_segmentUseCount = 0;
   bool m_bDelay = false;
   bool m_bDebugOutput = false;
+
+  // Read() only refreshes the file list near the known end or after this interval
+  std::chrono::steady_clock::time_point m_lastRefresh;
+  // Statistics: buffer file refreshes done and skipped, and file operations on the share
+  std::chrono::steady_clock::time_point m_openTime;
+  uint64_t m_refreshCount = 0;
+  uint64_t m_refreshSkipped = 0;
+  uint64_t m_fileOperations = 0;
 };
 } // namespace ArgusTV
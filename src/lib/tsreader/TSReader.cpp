@@ -20,6 +20,8 @@
 
 #include "TSReader.h"
 
+#include "BufferedReader.h"
+#include "LocalFileReader.h"
 #include "MultiFileReader.h"
 #include "utils.h"
 
@@ -56,17 +58,23 @@ long CTsReader::Open(const std::string& fileName)
 
   if ((length < 9) || (strnicmp(&url[length - 9], ".tsbuffer", 9) != 0))
   {
-    //local .ts file
+    //local .ts file, bypass Kodi's VFS when it is on a local filesystem
     m_bTimeShifting = false;
     m_bLiveTv = false;
-    m_fileReader = new FileReader();
+    if (LocalFileReader::IsLocalPath(m_fileName))
+      m_fileReader = new LocalFileReader();
+    else if (m_readAheadSize > 0)
+      m_fileReader = new BufferedReader(new FileReader(), m_readAheadSize,
+                                        BUFFEREDREADER_RECORDING_READ_SIZE);
+    else
+      m_fileReader = new FileReader();
   }
   else
   {
-    //local timeshift buffer file file
+    //local timeshift buffer file file, read ahead on a separate thread
     m_bTimeShifting = true;
     m_bLiveTv = true;
-    m_fileReader = new MultiFileReader();
+    m_fileReader = new BufferedReader(new MultiFileReader());
   }
 
   //open file
@@ -150,6 +158,11 @@ void CTsReader::OnZap(void)
   m_fileReader->OnZap();
 }
 
+bool CTsReader::WaitForData(unsigned int timeoutMs)
+{
+  return m_fileReader->WaitForData(timeoutMs);
+}
+
 #if defined(TARGET_WINDOWS)
 long long CTsReader::sigmaTime()
 {
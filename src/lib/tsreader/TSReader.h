@@ -33,6 +33,10 @@ class ATTR_DLL_LOCAL CTsReader
 public:
   CTsReader();
   ~CTsReader(void) = default;
+  /**
+   * \brief Read recordings on file shares this many bytes ahead, 0 disables it. Call before Open.
+   */
+  void SetReadAhead(size_t bufferSize) { m_readAheadSize = bufferSize; }
   long Open(const std::string& fileName);
   long Read(unsigned char* pbData, unsigned long lDataLength, unsigned long* dwReadBytes);
   void Close();
@@ -40,6 +44,10 @@ public:
   int64_t GetFileSize();
   int64_t GetFilePointer();
   void OnZap(void);
+  /**
+   * \brief Wait until the first packets can be read, at most timeoutMs milliseconds
+   */
+  bool WaitForData(unsigned int timeoutMs);
 #if defined(TARGET_WINDOWS)
   long long sigmaTime();
   long long sigmaCount();
@@ -50,6 +58,7 @@ private:
   bool m_bRecording = false;
   bool m_bLiveTv = false;
   std::string m_fileName;
+  size_t m_readAheadSize = 0;
   FileReader* m_fileReader = nullptr;
 #if defined(TARGET_WINDOWS)
   LARGE_INTEGER liDelta;
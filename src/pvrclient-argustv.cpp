@@ -9,11 +9,14 @@
 
 #include "pvrclient-argustv.h"
 
+#include "WorkerPool.h"
 #include "activerecording.h"
 #include "addon.h"
 #include "argustvrpc.h"
 #include "channel.h"
 #include "epg.h"
+#include "lib/tsreader/BufferedReader.h"
+#include "lib/tsreader/LocalFileReader.h"
 #include "lib/tsreader/TSReader.h"
 #include "recording.h"
 #include "recordinggroup.h"
@@ -21,6 +24,7 @@
 #include "utils.h"
 
 #include <chrono>
+#include <fstream>
 #include <kodi/General.h>
 #include <kodi/tools/StringUtils.h>
 #include <map>
@@ -32,6 +36,10 @@ using namespace ArgusTV;
 #define MAXLIFETIME \
   99 //Based on VDR addon and VDR documentation. 99=Keep forever, 0=can be deleted at any time, 1..98=days to keep
 
+static_assert(MAX_RECORDINGSTHREADS + MAX_EPGPREFETCHTHREADS + LOGOCACHE_WORKERS <=
+                  ATV_MAX_BULK_CONNECTIONS,
+              "the worker pools need more connections than bulk requests may use");
+
 template<typename T>
 void SafeDelete(T*& p)
 {
@@ -65,9 +73,9 @@ cPVRClientArgusTV::~cPVRClientArgusTV()
   }
   delete m_keepalive;
   delete m_eventmonitor;
-  // Free allocated memory for Channels
-  FreeChannels(m_TVChannels);
-  FreeChannels(m_RadioChannels);
+  // Stop prefetching and logo downloads before the RPC object goes away
+  m_epgPrefetcher.Stop();
+  m_logos.Stop();
 }
 
 PVR_ERROR cPVRClientArgusTV::GetCapabilities(kodi::addon::PVRCapabilities& capabilities)
@@ -101,7 +109,20 @@ bool cPVRClientArgusTV::Connect()
 
   kodi::Log(ADDON_LOG_INFO, "Connect() - Connecting to %s", m_baseURL.c_str());
 
-  m_rpc.Initialize(m_baseURL);
+  m_rpc.Initialize(m_baseURL, m_base.GetSettings().ReuseConnections());
+  m_epgCache.Initialize(kodi::addon::GetUserPath("epgcache/"));
+  std::string logoDirectory = m_base.GetSettings().LogoDirectory();
+  if (logoDirectory.empty())
+    logoDirectory = kodi::addon::GetUserPath("logos/");
+  else if (logoDirectory.back() != '/' && logoDirectory.back() != '\\')
+    logoDirectory += '/';
+  m_logos.Start(
+      logoDirectory, static_cast<uint64_t>(m_base.GetSettings().LogoCacheSize()) * 1024 * 1024,
+      [this](const std::string& channelGUID, time_t modifiedAfter, std::string& etag,
+             std::string& image) {
+        return m_rpc.GetChannelLogo(channelGUID, modifiedAfter, etag, image);
+      },
+      [this] { TriggerChannelUpdate(); });
 
   int backendversion = ATV_REST_MAXIMUM_API_VERSION;
   int rc = -2;
@@ -153,6 +174,8 @@ bool cPVRClientArgusTV::Connect()
   //    kodi::QueueNotification(QUEUE_ERROR, "", "Share errors: see xbmc.log");
   //  }
 
+  m_recordings.Invalidate();
+
   // Start service events monitor
   m_eventmonitor->Connect();
   m_eventmonitor->StartThread();
@@ -169,6 +192,11 @@ void cPVRClientArgusTV::Disconnect()
   // Stop service events monitor
   m_eventmonitor->StopThread();
 
+  m_epgPrefetcher.Stop();
+  m_epgPrefetcher.LogStatistics();
+  m_logos.Stop();
+  m_rpc.LogConnectionStatistics();
+
   if (m_bTimeShiftStarted)
   {
     //TODO: tell ArgusTV that it should stop streaming
@@ -310,71 +338,65 @@ PVR_ERROR cPVRClientArgusTV::GetEPGForChannel(int channelUid,
 {
   kodi::Log(ADDON_LOG_DEBUG, "->GetEPGForChannel(%i)", channelUid);
 
-  cChannel* atvchannel = FetchChannel(channelUid);
-  kodi::Log(ADDON_LOG_DEBUG, "ARGUS TV channel %p)", atvchannel);
-
-  struct tm* convert = localtime(&start);
-  struct tm tm_start = *convert;
-  convert = localtime(&end);
-  struct tm tm_end = *convert;
+  CChannelRegistry::ChannelPtr atvchannel = FetchChannel(channelUid);
+  kodi::Log(ADDON_LOG_DEBUG, "ARGUS TV channel %p)", atvchannel.get());
 
   if (atvchannel)
   {
-    Json::Value response;
-    int retval;
+    int retval = E_SUCCESS;
+    kodi::addon::PVREPGTag broadcast;
 
-    kodi::Log(ADDON_LOG_DEBUG, "Getting EPG Data for ARGUS TV channel %s)",
-              atvchannel->GuideChannelID().c_str());
-    retval = m_rpc.GetEPGData(atvchannel->GuideChannelID(), tm_start, tm_end, response);
+    std::string guideChannelId = atvchannel->GuideChannelID();
+    kodi::Log(ADDON_LOG_DEBUG, "Getting EPG Data for ARGUS TV channel %s)", guideChannelId.c_str());
 
-    if (retval != E_FAILED)
+    std::vector<cEpg> programs;
+    int prefetchThreads = m_base.GetSettings().EpgPrefetchThreads();
+    if (prefetchThreads > 0 && m_epgPrefetcher.Take(guideChannelId, start, end, programs))
     {
-      kodi::Log(ADDON_LOG_DEBUG,
-                "GetEPGData returned %i, response.type == %i, response.size == %i.", retval,
-                response.type(), response.size());
-      if (response.type() == Json::arrayValue)
-      {
-        int size = response.size();
-        kodi::addon::PVREPGTag broadcast;
-        cEpg internalEpg;
+      retval = static_cast<int>(programs.size());
+    }
+    else
+    {
+      if (prefetchThreads > 0)
+        StartEPGPrefetch(guideChannelId, start, end, prefetchThreads);
+      retval = LoadEPG(guideChannelId, start, end, programs);
+    }
 
-        // parse channel list
-        for (int index = 0; index < size; ++index)
-        {
-          if (internalEpg.Parse(response[index]))
-          {
-            m_epg_id_offset++;
-            broadcast.SetUniqueBroadcastId(m_epg_id_offset);
-            broadcast.SetTitle(internalEpg.Title());
-            broadcast.SetUniqueChannelId(channelUid);
-            broadcast.SetStartTime(internalEpg.StartTime());
-            broadcast.SetEndTime(internalEpg.EndTime());
-            broadcast.SetPlotOutline(internalEpg.Subtitle());
-            broadcast.SetPlot(internalEpg.Description());
-            broadcast.SetIconPath("");
-            broadcast.SetGenreType(EPG_GENRE_USE_STRING);
-            broadcast.SetGenreSubType(0);
-            broadcast.SetGenreDescription(internalEpg.Genre());
-            broadcast.SetFirstAired("");
-            broadcast.SetParentalRating(0);
-            broadcast.SetStarRating(0);
-            broadcast.SetSeriesNumber(EPG_TAG_INVALID_SERIES_EPISODE);
-            broadcast.SetEpisodeNumber(EPG_TAG_INVALID_SERIES_EPISODE);
-            broadcast.SetEpisodePartNumber(EPG_TAG_INVALID_SERIES_EPISODE);
-            broadcast.SetEpisodeName("");
-            broadcast.SetOriginalTitle("");
-            broadcast.SetCast("");
-            broadcast.SetDirector("");
-            broadcast.SetWriter("");
-            broadcast.SetYear(0);
-            broadcast.SetIMDBNumber("");
-            broadcast.SetFlags(EPG_TAG_FLAG_UNDEFINED);
-
-            results.Add(broadcast);
-          }
-          internalEpg.Reset();
-        }
-      }
+    for (const cEpg& internalEpg : programs)
+    {
+      m_epg_id_offset++;
+      broadcast.SetUniqueBroadcastId(m_epg_id_offset);
+      broadcast.SetTitle(internalEpg.Title());
+      broadcast.SetUniqueChannelId(channelUid);
+      broadcast.SetStartTime(internalEpg.StartTime());
+      broadcast.SetEndTime(internalEpg.EndTime());
+      broadcast.SetPlotOutline(internalEpg.Subtitle());
+      broadcast.SetPlot(internalEpg.Description());
+      broadcast.SetIconPath("");
+      broadcast.SetGenreType(EPG_GENRE_USE_STRING);
+      broadcast.SetGenreSubType(0);
+      broadcast.SetGenreDescription(internalEpg.Genre());
+      broadcast.SetFirstAired("");
+      broadcast.SetParentalRating(0);
+      broadcast.SetStarRating(0);
+      broadcast.SetSeriesNumber(EPG_TAG_INVALID_SERIES_EPISODE);
+      broadcast.SetEpisodeNumber(EPG_TAG_INVALID_SERIES_EPISODE);
+      broadcast.SetEpisodePartNumber(EPG_TAG_INVALID_SERIES_EPISODE);
+      broadcast.SetEpisodeName("");
+      broadcast.SetOriginalTitle("");
+      broadcast.SetCast("");
+      broadcast.SetDirector("");
+      broadcast.SetWriter("");
+      broadcast.SetYear(0);
+      broadcast.SetIMDBNumber("");
+      broadcast.SetFlags(EPG_TAG_FLAG_UNDEFINED);
+
+      results.Add(broadcast);
+    }
+
+    if (retval != E_FAILED)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "GetEPGData returned %i.", retval);
     }
     else
     {
@@ -390,6 +412,66 @@ PVR_ERROR cPVRClientArgusTV::GetEPGForChannel(int channelUid,
   return PVR_ERROR_NO_ERROR;
 }
 
+int cPVRClientArgusTV::LoadEPG(const std::string& guideChannelId,
+                               time_t start,
+                               time_t end,
+                               std::vector<cEpg>& programs)
+{
+  int epgCacheHours = m_base.GetSettings().EpgCacheHours();
+  if (epgCacheHours <= 0)
+    return FetchEPG(guideChannelId, start, end, programs);
+
+  // only fetch the parts of the window that are not cached (anymore)
+  int retval = E_SUCCESS;
+  m_epgCache.SetMaxAge(static_cast<time_t>(epgCacheHours) * 60 * 60);
+  uint64_t generation = m_epgCache.Generation();
+  for (const auto& range : m_epgCache.GetMissingRanges(guideChannelId, start, end))
+  {
+    std::vector<cEpg> fetched;
+    retval = FetchEPG(guideChannelId, range.first, range.second, fetched);
+    if (retval == E_FAILED)
+      break;
+    m_epgCache.Store(guideChannelId, range.first, range.second, fetched, generation);
+  }
+
+  // serve what is cached, even when the server could not fill all the gaps
+  programs = m_epgCache.GetPrograms(guideChannelId, start, end);
+  return retval;
+}
+
+int cPVRClientArgusTV::FetchEPG(const std::string& guideChannelId,
+                                time_t start,
+                                time_t end,
+                                std::vector<cEpg>& programs)
+{
+  struct tm tm_start = LocalTime(start);
+  struct tm tm_end = LocalTime(end);
+
+  return m_rpc.GetEPGData(guideChannelId, tm_start, tm_end, [&programs](const Json::Value& data) {
+    cEpg program;
+    if (program.Parse(data))
+      programs.push_back(std::move(program));
+  });
+}
+
+void cPVRClientArgusTV::StartEPGPrefetch(const std::string& handled,
+                                         time_t start,
+                                         time_t end,
+                                         int maxWorkers)
+{
+  std::vector<std::string> guideChannelIds;
+  for (const auto& channel : m_channels.All())
+    guideChannelIds.push_back(channel->GuideChannelID());
+
+  // The channel that triggered the round is loaded directly by the caller
+  m_epgPrefetcher.Start(guideChannelIds, handled, start, end, maxWorkers,
+                        [this](const std::string& guideChannelId, time_t windowStart,
+                               time_t windowEnd, std::vector<cEpg>& programs) {
+                          return LoadEPG(guideChannelId, windowStart, windowEnd, programs) !=
+                                 E_FAILED;
+                        });
+}
+
 /************************************************************/
 /** Channel handling */
 
@@ -424,7 +506,6 @@ PVR_ERROR cPVRClientArgusTV::GetChannelsAmount(int& amount)
 
 PVR_ERROR cPVRClientArgusTV::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& results)
 {
-  std::lock_guard<std::mutex> lock(m_ChannelCacheMutex);
   Json::Value response;
   int retval = -1;
 
@@ -443,38 +524,29 @@ PVR_ERROR cPVRClientArgusTV::GetChannels(bool radio, kodi::addon::PVRChannelsRes
 
   if (retval >= 0)
   {
-    if (radio)
-    {
-      FreeChannels(m_RadioChannels);
-      m_RadioChannels.clear();
-    }
-    else
-    {
-      FreeChannels(m_TVChannels);
-      m_TVChannels.clear();
-    }
+    std::vector<CChannelRegistry::ChannelPtr> channels;
     int size = response.size();
 
     // parse channel list
     for (int index = 0; index < size; ++index)
     {
 
-      cChannel* channel = new cChannel;
+      auto channel = std::make_shared<cChannel>();
       if (channel->Parse(response[index]))
       {
         kodi::addon::PVRChannel tag;
         tag.SetUniqueId(channel->ID());
         tag.SetChannelName(channel->Name());
-        tag.SetIconPath(m_rpc.GetChannelLogo(channel->Guid()));
+        tag.SetIconPath(m_logos.GetLogoPath(channel->Guid()));
         tag.SetEncryptionSystem((unsigned int)-1); //How to fetch this from ARGUS TV??
         tag.SetIsRadio(channel->Type() == CArgusTV::Radio ? true : false);
         tag.SetIsHidden(false);
         tag.SetMimeType("video/mp2t");
         tag.SetChannelNumber(channel->LCN());
 
+        channels.push_back(channel);
         if (!tag.GetIsRadio())
         {
-          m_TVChannels.push_back(channel);
           kodi::Log(
               ADDON_LOG_DEBUG,
               "Found TV channel: %s, Unique id: %d, ARGUS LCN: %d, ARGUS Id: %d, ARGUS GUID: %s\n",
@@ -483,7 +555,6 @@ PVR_ERROR cPVRClientArgusTV::GetChannels(bool radio, kodi::addon::PVRChannelsRes
         }
         else
         {
-          m_RadioChannels.push_back(channel);
           kodi::Log(ADDON_LOG_DEBUG,
                     "Found Radio channel: %s, Unique id: %d, ARGUS LCN: %d, ARGUS Id: %d, ARGUS "
                     "GUID: %s\n",
@@ -494,6 +565,8 @@ PVR_ERROR cPVRClientArgusTV::GetChannels(bool radio, kodi::addon::PVRChannelsRes
       }
     }
 
+    // lookups switch over to the new channel list at once
+    m_channels.Replace(radio ? CArgusTV::Radio : CArgusTV::Television, channels);
     return PVR_ERROR_NO_ERROR;
   }
   else
@@ -647,112 +720,153 @@ PVR_ERROR cPVRClientArgusTV::GetChannelGroupMembers(
 
 PVR_ERROR cPVRClientArgusTV::GetRecordingsAmount(bool deleted, int& amount)
 {
-  Json::Value response;
-  int retval = -1;
-  amount = 0;
-
   kodi::Log(ADDON_LOG_DEBUG, "GetNumRecordings()");
-  retval = m_rpc.GetRecordingGroupByTitle(response);
-  if (retval >= 0)
-  {
-    int size = response.size();
+  if (!UpdateRecordings())
+    return PVR_ERROR_SERVER_ERROR;
 
-    // parse channelgroup list
-    for (int index = 0; index < size; ++index)
+  amount = static_cast<int>(m_recordings.Count());
+  return PVR_ERROR_NO_ERROR;
+}
+
+bool cPVRClientArgusTV::UpdateRecordings()
+{
+  // Kodi asks again although the store did not change since its last list. Without service
+  // events there is no way to know what changed, and with them nothing was reported, so this is
+  // an explicit refresh: fetch everything. The amount and the list that Kodi requests next are
+  // served by one refresh.
+  m_recordings.InvalidateIfUnchanged(m_recordingsGeneration, m_eventmonitor->IsSubscribed());
+
+  auto fetchTitles = [this](std::vector<std::string>& titles) {
+    Json::Value recordinggroupresponse;
+    if (m_rpc.GetRecordingGroupByTitle(recordinggroupresponse) < 0)
+      return false;
+
+    // process list of recording groups
+    int size = recordinggroupresponse.size();
+    titles.reserve(size);
+    for (int recordinggroupindex = 0; recordinggroupindex < size; ++recordinggroupindex)
     {
       cRecordingGroup recordinggroup;
-      if (recordinggroup.Parse(response[index]))
-      {
-        amount += recordinggroup.RecordingsCount();
-      }
+      if (recordinggroup.Parse(recordinggroupresponse[recordinggroupindex]))
+        titles.push_back(recordinggroup.ProgramTitle());
     }
-
-    return PVR_ERROR_NO_ERROR;
+    return true;
+  };
+  auto fetchRecordings = [this](const std::string& title, std::vector<cRecording>& recordings) {
+    // Only a complete list replaces what is known of the title
+    std::vector<cRecording> fetched;
+    auto onRecording = [&fetched](const Json::Value& data) {
+      cRecording recording;
+      if (recording.Parse(data))
+        fetched.push_back(std::move(recording));
+    };
+    if (m_rpc.GetFullRecordingsForTitle(title, onRecording) < 0)
+      return false;
+    recordings.swap(fetched);
+    return true;
+  };
+  if (!m_recordings.Update(fetchTitles, fetchRecordings, m_base.GetSettings().RecordingsThreads()))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Could not get the recordings from the server.");
+    return false;
   }
-
-  return PVR_ERROR_SERVER_ERROR;
+  return true;
 }
 
 PVR_ERROR cPVRClientArgusTV::GetRecordings(bool deleted,
                                            kodi::addon::PVRRecordingsResultSet& results)
 {
-  Json::Value recordinggroupresponse;
-  int retval = -1;
   int iNumRecordings = 0;
 
-  m_RecordingsMap.clear();
-
   kodi::Log(ADDON_LOG_DEBUG, "RequestRecordingsList()");
   auto startTime = std::chrono::system_clock::now();
-  retval = m_rpc.GetRecordingGroupByTitle(recordinggroupresponse);
-  if (retval >= 0)
-  {
-    // process list of recording groups
-    int size = recordinggroupresponse.size();
-    for (int recordinggroupindex = 0; recordinggroupindex < size; ++recordinggroupindex)
+
+  if (!UpdateRecordings())
+    return PVR_ERROR_SERVER_ERROR;
+
+  auto addRecording = [&](const cRecording& recording, size_t titleCount) {
+    kodi::addon::PVRRecording tag;
+
+    //There may be cases where series and/or episode are populated withe 0 by default
+    //if neither value is more than 0, there is no value to use or show them
+    if (recording.SeriesNumber() > 0 || recording.EpisodeNumber() > 0)
     {
-      cRecordingGroup recordinggroup;
-      if (recordinggroup.Parse(recordinggroupresponse[recordinggroupindex]))
-      {
-        Json::Value recordingsbytitleresponse;
-        retval = m_rpc.GetFullRecordingsForTitle(recordinggroup.ProgramTitle(),
-                                                 recordingsbytitleresponse);
-        if (retval >= 0)
-        {
-          // process list of recording details for this group
-          int nrOfRecordings = recordingsbytitleresponse.size();
-          for (int recordingindex = 0; recordingindex < nrOfRecordings; recordingindex++)
-          {
-            cRecording recording;
-
-            if (recording.Parse(recordingsbytitleresponse[recordingindex]))
-            {
-              kodi::addon::PVRRecording tag;
-
-              //There may be cases where series and/or episode are populated withe 0 by default
-              //if neither value is more than 0, there is no value to use or show them
-              if (recording.SeriesNumber() > 0 || recording.EpisodeNumber() > 0)
-              {
-                tag.SetSeriesNumber(recording.SeriesNumber());
-                tag.SetEpisodeNumber(recording.EpisodeNumber());
-              }
-
-              tag.SetRecordingId(recording.RecordingId());
-              tag.SetChannelName(recording.ChannelDisplayName());
-              tag.SetLifetime(MAXLIFETIME); //TODO: recording.Lifetime());
-              tag.SetPriority(recording.SchedulePriority());
-              tag.SetRecordingTime(recording.RecordingStartTime());
-              tag.SetDuration(recording.RecordingStopTime() - recording.RecordingStartTime());
-              tag.SetPlot(recording.Description());
-              tag.SetPlayCount(recording.FullyWatchedCount());
-              tag.SetLastPlayedPosition(recording.LastWatchedPosition());
-              tag.SetTitle(recording.Title());
-              tag.SetEpisodeName(recording.SubTitle());
-              if (nrOfRecordings > 1 || m_base.GetSettings().UseFolder())
-                tag.SetDirectory(recording.Title());
-
-              m_RecordingsMap[tag.GetRecordingId()] = recording.RecordingFileName();
-
-              /* TODO: PVR API 5.0.0: Implement this */
-              tag.SetChannelUid(PVR_CHANNEL_INVALID_UID);
-
-              /* TODO: PVR API 5.1.0: Implement this */
-              tag.SetChannelType(PVR_RECORDING_CHANNEL_TYPE_UNKNOWN);
-
-              results.Add(tag);
-              iNumRecordings++;
-            }
-          }
-        }
-      }
+      tag.SetSeriesNumber(recording.SeriesNumber());
+      tag.SetEpisodeNumber(recording.EpisodeNumber());
     }
-  }
+
+    tag.SetRecordingId(recording.RecordingId());
+    tag.SetChannelName(recording.ChannelDisplayName());
+    tag.SetLifetime(MAXLIFETIME); //TODO: recording.Lifetime());
+    tag.SetPriority(recording.SchedulePriority());
+    tag.SetRecordingTime(recording.RecordingStartTime());
+    tag.SetDuration(recording.RecordingStopTime() - recording.RecordingStartTime());
+    tag.SetPlot(recording.Description());
+    tag.SetPlayCount(recording.FullyWatchedCount());
+    tag.SetLastPlayedPosition(recording.LastWatchedPosition());
+    tag.SetTitle(recording.Title());
+    tag.SetEpisodeName(recording.SubTitle());
+    if (titleCount > 1 || m_base.GetSettings().UseFolder())
+      tag.SetDirectory(recording.Title());
+
+    /* TODO: PVR API 5.0.0: Implement this */
+    tag.SetChannelUid(PVR_CHANNEL_INVALID_UID);
+
+    /* TODO: PVR API 5.1.0: Implement this */
+    tag.SetChannelType(PVR_RECORDING_CHANNEL_TYPE_UNKNOWN);
+
+    results.Add(tag);
+    iNumRecordings++;
+  };
+  // Remember the generation of exactly the recordings that Kodi gets
+  m_recordingsGeneration = m_recordings.ForEach(addRecording);
+
   auto totalTime = std::chrono::system_clock::now() - startTime;
   kodi::Log(ADDON_LOG_INFO, "Retrieving %d recordings took %d milliseconds.", iNumRecordings,
             std::chrono::duration_cast<std::chrono::milliseconds>(totalTime).count());
+  m_rpc.LogConnectionStatistics();
   return PVR_ERROR_NO_ERROR;
 }
 
+void cPVRClientArgusTV::RecordingChanged(const std::string& title)
+{
+  if (title.empty())
+    m_recordings.Invalidate();
+  else
+    m_recordings.InvalidateTitle(title);
+}
+
+void cPVRClientArgusTV::ChannelsChanged()
+{
+  // The channel registry is replaced as a whole when Kodi fetches the channels
+  TriggerChannelUpdate();
+  TriggerChannelGroupsUpdate();
+}
+
+void cPVRClientArgusTV::GuideChanged(const std::vector<std::string>& guideChannelIds)
+{
+  if (!guideChannelIds.empty())
+  {
+    // The data of the other guide channels stays cached and prefetched
+    for (const std::string& guideChannelId : guideChannelIds)
+    {
+      m_epgPrefetcher.Discard(guideChannelId);
+      m_epgCache.Invalidate(guideChannelId);
+      for (const CChannelRegistry::ChannelPtr& channel :
+           m_channels.FindByGuideChannelId(guideChannelId))
+        TriggerEpgUpdate(static_cast<unsigned int>(channel->ID()));
+    }
+    return;
+  }
+
+  // A running prefetch round skips its remaining channels, the cache drops what is still in
+  // flight from before the invalidation
+  m_epgPrefetcher.Discard();
+  m_epgCache.Invalidate();
+  for (const CChannelRegistry::ChannelPtr& channel : m_channels.All())
+    TriggerEpgUpdate(static_cast<unsigned int>(channel->ID()));
+}
+
 PVR_ERROR cPVRClientArgusTV::DeleteRecording(const kodi::addon::PVRRecording& recinfo)
 {
   PVR_ERROR rc = PVR_ERROR_FAILED;
@@ -773,7 +887,9 @@ PVR_ERROR cPVRClientArgusTV::DeleteRecording(const kodi::addon::PVRRecording& re
   if (m_rpc.DeleteRecording(jsonval) >= 0)
   {
     // Trigger XBMC to update it's list
+    RecordingChanged(recinfo.GetTitle());
     kodi::addon::CInstancePVRClient::TriggerRecordingUpdate();
+    m_eventmonitor->NotifyActivity();
     rc = PVR_ERROR_NO_ERROR;
   }
 
@@ -808,6 +924,9 @@ PVR_ERROR cPVRClientArgusTV::SetRecordingLastPlayedPosition(
     return PVR_ERROR_SERVER_ERROR;
   }
 
+  // The watched state is part of the recording details that are kept in memory
+  RecordingChanged(recinfo.GetTitle());
+
   return PVR_ERROR_NO_ERROR;
 }
 
@@ -863,6 +982,9 @@ PVR_ERROR cPVRClientArgusTV::SetRecordingPlayCount(const kodi::addon::PVRRecordi
     return PVR_ERROR_SERVER_ERROR;
   }
 
+  // The watched state is part of the recording details that are kept in memory
+  RecordingChanged(recinfo.GetTitle());
+
   return PVR_ERROR_NO_ERROR;
 }
 
@@ -891,11 +1013,32 @@ PVR_ERROR cPVRClientArgusTV::GetRecordingEdl(const kodi::addon::PVRRecording& re
 
     kodi::Log(ADDON_LOG_DEBUG, "Opening EDL file: '%s'", theEdlFile.c_str());
 
-    kodi::vfs::CFile fileHandle;
-    if (fileHandle.OpenFile(theEdlFile))
+    // Local files are read directly, bypassing Kodi's VFS
+    std::vector<std::string> lines;
+    bool found = false;
+    if (ArgusTV::LocalFileReader::IsLocalPath(theEdlFile))
+    {
+      std::ifstream localFile(ArgusTV::LocalFileReader::ToNativePath(theEdlFile));
+      std::string line;
+      while (std::getline(localFile, line))
+        lines.push_back(line);
+      found = localFile.eof();
+    }
+    else
     {
-      std::string svals;
-      while (fileHandle.ReadLine(svals))
+      kodi::vfs::CFile fileHandle;
+      std::string line;
+      if (fileHandle.OpenFile(theEdlFile))
+      {
+        while (fileHandle.ReadLine(line))
+          lines.push_back(line);
+        found = true;
+      }
+    }
+
+    if (found)
+    {
+      for (std::string& svals : lines)
       {
         size_t nidx = svals.find_last_not_of("\r");
         svals.erase(svals.npos == nidx ? 0 : ++nidx); // trim windows /r if its there
@@ -930,50 +1073,40 @@ PVR_ERROR cPVRClientArgusTV::GetRecordingEdl(const kodi::addon::PVRRecording& re
 PVR_ERROR cPVRClientArgusTV::GetTimersAmount(int& amount)
 {
   // Not directly possible in ARGUS TV
-  Json::Value response;
-
   kodi::Log(ADDON_LOG_DEBUG, "GetNumTimers()");
   // pick up the schedulelist for TV
-  int retval = m_rpc.GetUpcomingRecordings(response);
+  int retval = m_rpc.GetUpcomingRecordings([](const Json::Value&) {});
   if (retval < 0)
   {
     return PVR_ERROR_SERVER_ERROR;
   }
 
-  amount = response.size();
+  amount = retval;
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR cPVRClientArgusTV::GetTimers(kodi::addon::PVRTimersResultSet& results)
 {
-  Json::Value activeRecordingsResponse, upcomingRecordingsResponse;
+  Json::Value activeRecordingsResponse;
+  ActiveRecordingIndex activeRecordings;
+  std::vector<kodi::addon::PVRTimer> timers;
   int iNumberOfTimers = 0;
-  int numberoftimers;
 
   kodi::Log(ADDON_LOG_DEBUG, "%s", __FUNCTION__);
 
   // retrieve the currently active recordings
-  int retval = m_rpc.GetActiveRecordings(activeRecordingsResponse);
+  int retval = FetchActiveRecordings(activeRecordingsResponse, activeRecordings);
   if (retval < 0)
   {
     kodi::Log(ADDON_LOG_ERROR, "Unable to retrieve active recordings from server.");
     return PVR_ERROR_SERVER_ERROR;
   }
 
-  // pick up the upcoming recordings
-  retval = m_rpc.GetUpcomingRecordings(upcomingRecordingsResponse);
-  if (retval < 0)
-  {
-    kodi::Log(ADDON_LOG_ERROR, "Unable to retrieve upcoming programs from server.");
-    return PVR_ERROR_SERVER_ERROR;
-  }
-
-  numberoftimers = upcomingRecordingsResponse.size();
-
-  for (int i = 0; i < numberoftimers; i++)
-  {
+  // pick up the upcoming recordings, they are converted while being downloaded and handed to
+  // Kodi once the complete list arrived
+  retval = m_rpc.GetUpcomingRecordings([&](const Json::Value& data) {
     cUpcomingRecording upcomingrecording;
-    if (upcomingrecording.Parse(upcomingRecordingsResponse[i]))
+    if (upcomingrecording.Parse(data))
     {
       kodi::addon::PVRTimer tag;
 
@@ -1010,22 +1143,9 @@ PVR_ERROR cPVRClientArgusTV::GetTimers(kodi::addon::PVRTimersResultSet& results)
       if (tag.GetState() == PVR_TIMER_STATE_SCHEDULED ||
           tag.GetState() == PVR_TIMER_STATE_CONFLICT_OK) //check if they are currently recording
       {
-        if (activeRecordingsResponse.size() > 0)
-        {
-          // Is the this upcoming recording in the list of active recordings?
-          for (Json::Value::UInt j = 0; j < activeRecordingsResponse.size(); j++)
-          {
-            cActiveRecording activerecording;
-            if (activerecording.Parse(activeRecordingsResponse[j]))
-            {
-              if (upcomingrecording.UpcomingProgramId() == activerecording.UpcomingProgramId())
-              {
-                tag.SetState(PVR_TIMER_STATE_RECORDING);
-                break;
-              }
-            }
-          }
-        }
+        // Is the this upcoming recording in the list of active recordings?
+        if (activeRecordings.count(upcomingrecording.UpcomingProgramId()) > 0)
+          tag.SetState(PVR_TIMER_STATE_RECORDING);
       }
 
       tag.SetTitle(upcomingrecording.Title());
@@ -1041,7 +1161,7 @@ PVR_ERROR cPVRClientArgusTV::GetTimers(kodi::addon::PVRTimersResultSet& results)
       tag.SetGenreType(0);
       tag.SetGenreSubType(0);
 
-      results.Add(tag);
+      timers.push_back(tag);
 
       kodi::Log(ADDON_LOG_DEBUG,
                 "Found timer: %s, Unique id: %d, ARGUS ProgramId: %d, ARGUS ChannelId: %d\n",
@@ -1049,8 +1169,16 @@ PVR_ERROR cPVRClientArgusTV::GetTimers(kodi::addon::PVRTimersResultSet& results)
                 upcomingrecording.ChannelID());
       iNumberOfTimers++;
     }
+  });
+  if (retval < 0)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Unable to retrieve upcoming programs from server.");
+    return PVR_ERROR_SERVER_ERROR;
   }
 
+  for (const kodi::addon::PVRTimer& tag : timers)
+    results.Add(tag);
+
   return PVR_ERROR_NO_ERROR;
 }
 
@@ -1060,7 +1188,7 @@ PVR_ERROR cPVRClientArgusTV::AddTimer(const kodi::addon::PVRTimer& timerinfo)
             timerinfo.GetTitle().c_str(), timerinfo.GetStartTime(), timerinfo.GetEndTime());
 
   // re-synthesize the ARGUS TV channel GUID
-  cChannel* pChannel = FetchChannel(timerinfo.GetClientChannelUid());
+  CChannelRegistry::ChannelPtr pChannel = FetchChannel(timerinfo.GetClientChannelUid());
   if (pChannel == nullptr)
   {
     kodi::Log(ADDON_LOG_ERROR,
@@ -1144,102 +1272,110 @@ PVR_ERROR cPVRClientArgusTV::AddTimer(const kodi::addon::PVRTimer& timerinfo)
     }
   }
 
-  // Trigger an update of the PVR timers
+  // Trigger an update of the PVR timers, the server reports the resulting changes soon
   kodi::addon::CInstancePVRClient::TriggerTimerUpdate();
+  m_eventmonitor->NotifyActivity();
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR cPVRClientArgusTV::DeleteTimer(const kodi::addon::PVRTimer& timerinfo, bool force)
 {
   NOTUSED(force);
-  Json::Value upcomingProgramsResponse, activeRecordingsResponse;
+  Json::Value activeRecordingsResponse;
+  ActiveRecordingIndex activeRecordings;
 
   kodi::Log(ADDON_LOG_DEBUG, "DeleteTimer()");
 
   // retrieve the currently active recordings
-  int retval = m_rpc.GetActiveRecordings(activeRecordingsResponse);
+  int retval = FetchActiveRecordings(activeRecordingsResponse, activeRecordings);
   if (retval < 0)
   {
     kodi::Log(ADDON_LOG_ERROR, "Unable to retrieve active recordings from server.");
     return PVR_ERROR_SERVER_ERROR;
   }
 
-  // pick up the upcoming recordings
-  retval = m_rpc.GetUpcomingRecordings(upcomingProgramsResponse);
+  // pick up the upcoming recordings and find the one that matches this xbmc timer
+  cUpcomingRecording upcomingrecording;
+  bool found = false;
+  retval = m_rpc.GetUpcomingRecordings([&](const Json::Value& data) {
+    cUpcomingRecording candidate;
+    if (!found && candidate.Parse(data) && candidate.ID() == (int)timerinfo.GetClientIndex())
+    {
+      upcomingrecording = candidate;
+      found = true;
+    }
+  });
   if (retval < 0)
   {
     kodi::Log(ADDON_LOG_ERROR, "Unable to retrieve upcoming programs from server.");
     return PVR_ERROR_SERVER_ERROR;
   }
+  if (!found)
+    return PVR_ERROR_SERVER_ERROR;
 
-  // try to find the upcoming recording that matches this xbmc timer
-  int numberoftimers = upcomingProgramsResponse.size();
-  for (int i = 0; i < numberoftimers; i++)
+  // Okay, we matched the timer to an upcoming program, but is it recording right now?
+  auto activeRecording = activeRecordings.find(upcomingrecording.UpcomingProgramId());
+  if (activeRecording != activeRecordings.end())
   {
-    cUpcomingRecording upcomingrecording;
-    if (upcomingrecording.Parse(upcomingProgramsResponse[i]))
+    // Abort this recording
+    retval = m_rpc.AbortActiveRecording(activeRecordingsResponse[activeRecording->second]);
+    if (retval != 0)
     {
-      if (upcomingrecording.ID() == (int)timerinfo.GetClientIndex())
-      {
-        // Okay, we matched the timer to an upcoming program, but is it recording right now?
-        if (activeRecordingsResponse.size() > 0)
-        {
-          // Is the this upcoming program in the list of active recordings?
-          for (Json::Value::UInt j = 0; j < activeRecordingsResponse.size(); j++)
-          {
-            cActiveRecording activerecording;
-            if (activerecording.Parse(activeRecordingsResponse[j]))
-            {
-              if (upcomingrecording.UpcomingProgramId() == activerecording.UpcomingProgramId())
-              {
-                // Abort this recording
-                retval = m_rpc.AbortActiveRecording(activeRecordingsResponse[j]);
-                if (retval != 0)
-                {
-                  kodi::Log(ADDON_LOG_ERROR,
-                            "Unable to cancel the active recording of \"%s\" on the server. Will "
-                            "try to cancel the program.",
-                            upcomingrecording.Title().c_str());
-                }
-                break;
-              }
-            }
-          }
-        }
-
-        Json::Value scheduleResponse;
-        retval = m_rpc.GetScheduleById(upcomingrecording.ScheduleId(), scheduleResponse);
-        std::string schedulename = scheduleResponse["Name"].asString();
+      kodi::Log(ADDON_LOG_ERROR,
+                "Unable to cancel the active recording of \"%s\" on the server. Will try to "
+                "cancel the program.",
+                upcomingrecording.Title().c_str());
+    }
+  }
 
-        if (scheduleResponse["IsOneTime"].asBool() == true)
-        {
-          retval = m_rpc.DeleteSchedule(upcomingrecording.ScheduleId());
-          if (retval < 0)
-          {
-            kodi::Log(ADDON_LOG_INFO, "Unable to delete schedule %s from server.",
-                      schedulename.c_str());
-            return PVR_ERROR_SERVER_ERROR;
-          }
-        }
-        else
-        {
-          retval = m_rpc.CancelUpcomingProgram(
-              upcomingrecording.ScheduleId(), upcomingrecording.ChannelId(),
-              upcomingrecording.StartTime(), upcomingrecording.GuideProgramId());
-          if (retval < 0)
-          {
-            kodi::Log(ADDON_LOG_ERROR, "Unable to cancel upcoming program from server.");
-            return PVR_ERROR_SERVER_ERROR;
-          }
-        }
+  Json::Value scheduleResponse;
+  retval = m_rpc.GetScheduleById(upcomingrecording.ScheduleId(), scheduleResponse);
+  std::string schedulename = scheduleResponse["Name"].asString();
 
-        // Trigger an update of the PVR timers
-        kodi::addon::CInstancePVRClient::TriggerTimerUpdate();
-        return PVR_ERROR_NO_ERROR;
-      }
+  if (scheduleResponse["IsOneTime"].asBool() == true)
+  {
+    retval = m_rpc.DeleteSchedule(upcomingrecording.ScheduleId());
+    if (retval < 0)
+    {
+      kodi::Log(ADDON_LOG_INFO, "Unable to delete schedule %s from server.", schedulename.c_str());
+      return PVR_ERROR_SERVER_ERROR;
     }
   }
-  return PVR_ERROR_SERVER_ERROR;
+  else
+  {
+    retval = m_rpc.CancelUpcomingProgram(upcomingrecording.ScheduleId(),
+                                         upcomingrecording.ChannelId(),
+                                         upcomingrecording.StartTime(),
+                                         upcomingrecording.GuideProgramId());
+    if (retval < 0)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "Unable to cancel upcoming program from server.");
+      return PVR_ERROR_SERVER_ERROR;
+    }
+  }
+
+  // Trigger an update of the PVR timers, the server reports the resulting changes soon
+  kodi::addon::CInstancePVRClient::TriggerTimerUpdate();
+  m_eventmonitor->NotifyActivity();
+  return PVR_ERROR_NO_ERROR;
+}
+
+int cPVRClientArgusTV::FetchActiveRecordings(Json::Value& response, ActiveRecordingIndex& index)
+{
+  int retval = m_rpc.GetActiveRecordings(response);
+  if (retval < 0)
+    return retval;
+
+  // parse every active recording once, timers are matched by their UpcomingProgramId
+  index.clear();
+  index.reserve(response.size());
+  for (Json::Value::ArrayIndex i = 0; i < response.size(); i++)
+  {
+    cActiveRecording activerecording;
+    if (activerecording.Parse(response[i]))
+      index.emplace(activerecording.UpcomingProgramId(), i);
+  }
+  return retval;
 }
 
 PVR_ERROR cPVRClientArgusTV::UpdateTimer(const kodi::addon::PVRTimer& timerinfo)
@@ -1251,12 +1387,9 @@ PVR_ERROR cPVRClientArgusTV::UpdateTimer(const kodi::addon::PVRTimer& timerinfo)
 
 /************************************************************/
 /** Live stream handling */
-cChannel* cPVRClientArgusTV::FetchChannel(int channelid, bool LogError)
+CChannelRegistry::ChannelPtr cPVRClientArgusTV::FetchChannel(int channelid, bool LogError)
 {
-  std::lock_guard<std::mutex> lock(m_ChannelCacheMutex);
-  cChannel* rc = FetchChannel(m_TVChannels, channelid, false);
-  if (rc == nullptr)
-    rc = FetchChannel(m_RadioChannels, channelid, false);
+  CChannelRegistry::ChannelPtr rc = m_channels.FindById(channelid);
 
   if (LogError && rc == nullptr)
     kodi::Log(ADDON_LOG_ERROR, "XBMC channel with id %d not found in the channel caches!.",
@@ -1264,38 +1397,6 @@ cChannel* cPVRClientArgusTV::FetchChannel(int channelid, bool LogError)
   return rc;
 }
 
-cChannel* cPVRClientArgusTV::FetchChannel(std::vector<cChannel*> m_Channels,
-                                          int channelid,
-                                          bool LogError)
-{
-  // Search for this channel in our local channel list to find the original ChannelID back:
-  std::vector<cChannel*>::iterator it;
-
-  for (it = m_Channels.begin(); it < m_Channels.end(); it++)
-  {
-    if ((*it)->ID() == channelid)
-    {
-      return *it;
-    }
-  }
-
-  if (LogError)
-    kodi::Log(ADDON_LOG_ERROR, "XBMC channel with id %d not found in the channel cache!.",
-              channelid);
-  return nullptr;
-}
-
-void cPVRClientArgusTV::FreeChannels(std::vector<cChannel*> m_Channels)
-{
-  // Search for this channel in our local channel list to find the original ChannelID back:
-  std::vector<cChannel*>::iterator it;
-
-  for (it = m_Channels.begin(); it < m_Channels.end(); it++)
-  {
-    SafeDelete(*it);
-  }
-}
-
 bool cPVRClientArgusTV::_OpenLiveStream(const kodi::addon::PVRChannel& channelinfo)
 {
   kodi::Log(ADDON_LOG_DEBUG, "->_OpenLiveStream(%i)", channelinfo.GetUniqueId());
@@ -1310,7 +1411,7 @@ bool cPVRClientArgusTV::_OpenLiveStream(const kodi::addon::PVRChannel& channelin
   m_iCurrentChannel =
       -1; // make sure that it is not a valid channel nr in case it will fail lateron
 
-  cChannel* channel = FetchChannel(channelinfo.GetUniqueId());
+  CChannelRegistry::ChannelPtr channel = FetchChannel(channelinfo.GetUniqueId());
 
   if (channel)
   {
@@ -1370,6 +1471,8 @@ bool cPVRClientArgusTV::_OpenLiveStream(const kodi::addon::PVRChannel& channelin
     m_bTimeShiftStarted = true;
     m_iCurrentChannel = channelinfo.GetUniqueId();
     m_keepalive->StartThread();
+    // Tuning may start or end recordings on the server
+    m_eventmonitor->NotifyActivity();
 
 #if defined(ATV_DUMPTS)
     if (ofd != -1)
@@ -1401,8 +1504,13 @@ bool cPVRClientArgusTV::_OpenLiveStream(const kodi::addon::PVRChannel& channelin
     kodi::Log(ADDON_LOG_DEBUG, "Open TsReader");
     m_tsreader->Open(filename.c_str());
     m_tsreader->OnZap();
-    kodi::Log(ADDON_LOG_DEBUG, "Delaying %ld milliseconds.", m_base.GetSettings().TuneDelay());
-    std::this_thread::sleep_for(std::chrono::milliseconds(m_base.GetSettings().TuneDelay()));
+    // Return as soon as the new channel's first packets arrive, wait no longer than the tune delay
+    auto waitStart = std::chrono::steady_clock::now();
+    bool ready = m_tsreader->WaitForData(m_base.GetSettings().TuneDelay());
+    kodi::Log(ADDON_LOG_DEBUG, "%s after %d milliseconds.", ready ? "Data available" : "No data yet",
+              static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - waitStart)
+                                   .count()));
     return true;
   }
   else
@@ -1428,42 +1536,18 @@ bool cPVRClientArgusTV::OpenLiveStream(const kodi::addon::PVRChannel& channelinf
 
 int cPVRClientArgusTV::ReadLiveStream(unsigned char* pBuffer, unsigned int iBufferSize)
 {
-  unsigned long read_wanted = iBufferSize;
   unsigned long read_done = 0;
-  static int read_timeouts = 0;
-  unsigned char* bufptr = pBuffer;
 
   // kodi::Log(ADDON_LOG_DEBUG, "->ReadLiveStream(buf_size=%i)", iBufferSize);
   if (!m_tsreader)
     return -1;
 
-  while (read_done < (unsigned long)iBufferSize)
+  // The timeshift buffer is read ahead on a separate thread, this only waits when it ran dry
+  m_tsreader->Read(pBuffer, iBufferSize, &read_done);
+  if (read_done == 0)
   {
-    read_wanted = iBufferSize - read_done;
-
-    long lRc = 0;
-    if ((lRc = m_tsreader->Read(bufptr, read_wanted, &read_wanted)) > 0)
-    {
-      std::this_thread::sleep_for(std::chrono::milliseconds(400));
-      read_timeouts++;
-      kodi::Log(ADDON_LOG_INFO, "ReadLiveStream requested %d but only read %d bytes.", iBufferSize,
-                read_wanted);
-      return read_wanted;
-    }
-    read_done += read_wanted;
-
-    if (read_done < (unsigned long)iBufferSize)
-    {
-      if (read_timeouts > 25)
-      {
-        kodi::Log(ADDON_LOG_INFO, "No data in 1 second");
-        read_timeouts = 0;
-        return read_done;
-      }
-      bufptr += read_wanted;
-      read_timeouts++;
-      std::this_thread::sleep_for(std::chrono::milliseconds(40));
-    }
+    kodi::Log(ADDON_LOG_INFO, "No data in %d milliseconds", BUFFEREDREADER_WAIT_TIMEOUT);
+    return 0;
   }
 #if defined(ATV_DUMPTS)
   if (write(ofd, pBuffer, read_done) < 0)
@@ -1472,8 +1556,6 @@ int cPVRClientArgusTV::ReadLiveStream(unsigned char* pBuffer, unsigned int iBuff
               ofn, errno, strerror(errno));
   }
 #endif
-  // kodi::Log(ADDON_LOG_DEBUG, "ReadLiveStream(buf_size=%i), %d timeouts", iBufferSize, read_timeouts);
-  read_timeouts = 0;
   return read_done;
 }
 
@@ -1590,11 +1672,11 @@ PVR_ERROR cPVRClientArgusTV::GetSignalStatus(int channelUid,
 
 bool cPVRClientArgusTV::FindRecEntryUNC(const std::string& recId, std::string& recEntryURL)
 {
-  auto iter = m_RecordingsMap.find(recId);
-  if (iter == m_RecordingsMap.end())
+  std::string fileName;
+  if (!m_recordings.FindFileName(recId, fileName))
     return false;
 
-  recEntryURL = ToUNC(iter->second);
+  recEntryURL = ToUNC(fileName);
   if (recEntryURL == "")
     return false;
 
@@ -1603,11 +1685,9 @@ bool cPVRClientArgusTV::FindRecEntryUNC(const std::string& recId, std::string& r
 
 bool cPVRClientArgusTV::FindRecEntry(const std::string& recId, std::string& recEntryURL)
 {
-  auto iter = m_RecordingsMap.find(recId);
-  if (iter == m_RecordingsMap.end())
+  if (!m_recordings.FindFileName(recId, recEntryURL))
     return false;
 
-  recEntryURL = iter->second;
   InsertUser(m_base, recEntryURL);
 
   return !recEntryURL.empty();
@@ -1631,6 +1711,7 @@ bool cPVRClientArgusTV::OpenRecordedStream(const kodi::addon::PVRRecording& reci
     SafeDelete(m_tsreader);
   }
   m_tsreader = new CTsReader();
+  m_tsreader->SetReadAhead(static_cast<size_t>(m_base.GetSettings().ReadAheadSize()) * 1024 * 1024);
   if (m_tsreader->Open(UNCname.c_str()) != S_OK)
   {
     SafeDelete(m_tsreader);
@@ -8,16 +8,22 @@
 
 #pragma once
 
+#include "ChannelLogoCache.h"
+#include "ChannelRegistry.h"
+#include "EpgCache.h"
+#include "EpgPrefetcher.h"
 #include "EventsThread.h"
 #include "KeepAliveThread.h"
+#include "RecordingStore.h"
 #include "addon.h"
 #include "argustvrpc.h"
 #include "channel.h"
 #include "guideprogram.h"
 #include "recording.h"
 
+#include <atomic>
 #include <kodi/addon-instance/PVR.h>
-#include <map>
+#include <unordered_map>
 #include <vector>
 
 namespace ArgusTV
@@ -107,14 +113,43 @@ public:
 
   CArgusTV& GetRPC() { return m_rpc; }
 
+  /**
+   * \brief Fetch the recordings of a title again at the next recordings update
+   * \param title The changed title, empty when it is unknown and all recordings must be fetched
+   */
+  void RecordingChanged(const std::string& title);
+
+  /**
+   * \brief Let Kodi fetch the channels and channel groups again
+   */
+  void ChannelsChanged();
+
+  /**
+   * \brief Drop the cached guide data of the given guide channels and let Kodi fetch the guide
+   * of the channels using them again
+   * \param guideChannelIds The changed guide channels, all of them when empty
+   */
+  void GuideChanged(const std::vector<std::string>& guideChannelIds);
+
 private:
-  cChannel* FetchChannel(int channelid, bool LogError = true);
-  cChannel* FetchChannel(std::vector<cChannel*> m_Channels, int channelid, bool LogError = true);
-  void FreeChannels(std::vector<cChannel*> m_Channels);
+  CChannelRegistry::ChannelPtr FetchChannel(int channelid, bool LogError = true);
   void Close();
   bool _OpenLiveStream(const kodi::addon::PVRChannel& channel);
   bool FindRecEntryUNC(const std::string& recId, std::string& recEntryURL);
   bool FindRecEntry(const std::string& recId, std::string& recEntryURL);
+  bool UpdateRecordings();
+  int LoadEPG(const std::string& guideChannelId,
+              time_t start,
+              time_t end,
+              std::vector<cEpg>& programs);
+  int FetchEPG(const std::string& guideChannelId,
+               time_t start,
+               time_t end,
+               std::vector<cEpg>& programs);
+  void StartEPGPrefetch(const std::string& handled, time_t start, time_t end, int maxWorkers);
+  // UpcomingProgramId -> index in the active recordings response
+  using ActiveRecordingIndex = std::unordered_map<std::string, Json::Value::ArrayIndex>;
+  int FetchActiveRecordings(Json::Value& response, ActiveRecordingIndex& index);
 
   int m_iCurrentChannel = -1;
   bool m_bConnected = false;
@@ -125,14 +160,12 @@ private:
   time_t m_BackendUTCoffset = 0;
   time_t m_BackendTime = 0;
 
-  std::mutex m_ChannelCacheMutex;
-  std::vector<cChannel*>
-      m_TVChannels; // Local TV channel cache list needed for id to guid conversion
-  std::vector<cChannel*>
-      m_RadioChannels; // Local Radio channel cache list needed for id to guid conversion
-  std::map<std::string, std::string>
-      m_RecordingsMap; // <PVR_RECORDING.strRecordingId, URL of recording>
+  CChannelRegistry m_channels; // Local channel cache needed for id to guid conversion
+  CRecordingStore m_recordings;
+  std::atomic<uint64_t> m_recordingsGeneration = {0}; // generation of the store Kodi got last
   int m_epg_id_offset = 0;
+  CEpgCache m_epgCache;
+  CEpgPrefetcher m_epgPrefetcher;
   int m_signalqualityInterval = 0;
   ArgusTV::CTsReader* m_tsreader = nullptr;
   CKeepAliveThread* m_keepalive = {new CKeepAliveThread(*this)};
@@ -145,5 +178,6 @@ private:
 
   std::string m_baseURL;
   CArgusTV m_rpc;
+  CChannelLogoCache m_logos; // after m_rpc, its workers download through it
   const CArgusTVAddon& m_base;
 };
@@ -40,21 +40,16 @@ bool cRecording::Parse(const Json::Value& data)
   keepuntilvalue = data["KeepUntilValue"].asInt();
   lastwatchedposition = data["LastWatchedPosition"].asInt();
   fullywatchedcount = data["FullyWatchedCount"].asInt();
-  t = data["LastWatchedTime"].asString();
-  lastwatchedtime = CArgusTV::WCFDateToTimeT(t, offset);
-  t = data["ProgramStartTime"].asString();
-  programstarttime = CArgusTV::WCFDateToTimeT(t, offset);
-  t = data["ProgramStopTime"].asString();
-  programstoptime = CArgusTV::WCFDateToTimeT(t, offset);
+  lastwatchedtime = CArgusTV::WCFDateToTimeT(data["LastWatchedTime"], offset);
+  programstarttime = CArgusTV::WCFDateToTimeT(data["ProgramStartTime"], offset);
+  programstoptime = CArgusTV::WCFDateToTimeT(data["ProgramStopTime"], offset);
   rating = data["Rating"].asString();
   recordingfileformatid = data["RecordingFileFormatId"].asString();
   t = data["RecordingFileName"].asString();
   recordingfilename = ToCIFS(t);
   recordingid = data["RecordingId"].asString();
-  t = data["RecordingStartTime"].asString();
-  recordingstarttime = CArgusTV::WCFDateToTimeT(t, offset);
-  t = data["RecordingStopTime"].asString();
-  recordingstoptime = CArgusTV::WCFDateToTimeT(t, offset);
+  recordingstarttime = CArgusTV::WCFDateToTimeT(data["RecordingStartTime"], offset);
+  recordingstoptime = CArgusTV::WCFDateToTimeT(data["RecordingStopTime"], offset);
   scheduleid = data["ScheduleId"].asString();
   schedulename = data["ScheduleName"].asString();
   schedulepriority = (CArgusTV::SchedulePriority)data["SchedulePriority"].asInt();
@@ -24,8 +24,7 @@ bool cRecordingGroup::Parse(const Json::Value& data)
   channeltype = (CArgusTV::ChannelType)data["ChannelType"].asInt();
   isrecording = data["IsRecording"].asBool();
   int offset;
-  std::string lpst = data["LatestProgramStartTime"].asString();
-  latestprogramstarttime = CArgusTV::WCFDateToTimeT(lpst, offset);
+  latestprogramstarttime = CArgusTV::WCFDateToTimeT(data["LatestProgramStartTime"], offset);
   latestprogramstarttime += ((offset / 100) * 3600);
   programtitle = data["ProgramTitle"].asString();
   recordinggroupmode = (CArgusTV::RecordingGroupMode)data["RecordingGroupMode"].asInt();
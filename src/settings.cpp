@@ -84,6 +84,74 @@ bool CSettings::Load()
     m_bUseFolder = DEFAULT_USEFOLDER;
   }
 
+  /* Read setting "recordingsthreads" from settings.xml */
+  if (!kodi::addon::CheckSettingInt("recordingsthreads", m_iRecordingsThreads))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'recordingsthreads' setting, falling back to '%i' as default",
+              DEFAULT_RECORDINGSTHREADS);
+    m_iRecordingsThreads = DEFAULT_RECORDINGSTHREADS;
+  }
+
+  /* Read setting "reuseconnections" from settings.xml */
+  if (!kodi::addon::CheckSettingBoolean("reuseconnections", m_bReuseConnections))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'reuseconnections' setting, falling back to 'true' as default");
+    m_bReuseConnections = DEFAULT_REUSECONNECTIONS;
+  }
+
+  /* Read setting "epgcachehours" from settings.xml */
+  if (!kodi::addon::CheckSettingInt("epgcachehours", m_iEpgCacheHours))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'epgcachehours' setting, falling back to '%i' as default",
+              DEFAULT_EPGCACHEHOURS);
+    m_iEpgCacheHours = DEFAULT_EPGCACHEHOURS;
+  }
+
+  /* Read setting "epgprefetchthreads" from settings.xml */
+  if (!kodi::addon::CheckSettingInt("epgprefetchthreads", m_iEpgPrefetchThreads))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'epgprefetchthreads' setting, falling back to '%i' as default",
+              DEFAULT_EPGPREFETCHTHREADS);
+    m_iEpgPrefetchThreads = DEFAULT_EPGPREFETCHTHREADS;
+  }
+
+  /* Read setting "logodirectory" from settings.xml */
+  if (!kodi::addon::CheckSettingString("logodirectory", m_szLogoDirectory))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'logodirectory' setting, falling back to the profile directory");
+    m_szLogoDirectory = DEFAULT_LOGODIRECTORY;
+  }
+
+  /* Read setting "logocachesize" from settings.xml */
+  if (!kodi::addon::CheckSettingInt("logocachesize", m_iLogoCacheSize))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'logocachesize' setting, falling back to '%i' as default",
+              DEFAULT_LOGOCACHESIZE);
+    m_iLogoCacheSize = DEFAULT_LOGOCACHESIZE;
+  }
+
+  /* Read setting "readaheadsize" from settings.xml */
+  if (!kodi::addon::CheckSettingInt("readaheadsize", m_iReadAheadSize))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR,
+              "Couldn't get 'readaheadsize' setting, falling back to '%i' as default",
+              DEFAULT_READAHEADSIZE);
+    m_iReadAheadSize = DEFAULT_READAHEADSIZE;
+  }
+
   return true;
 }
 
@@ -146,6 +214,61 @@ ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
               settingValue.GetBoolean());
     m_bUseFolder = settingValue.GetBoolean();
   }
+  else if (settingName == "recordingsthreads")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed setting 'recordingsthreads' from %u to %u",
+              m_iRecordingsThreads, settingValue.GetInt());
+    m_iRecordingsThreads = settingValue.GetInt();
+  }
+  else if (settingName == "reuseconnections")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed setting 'reuseconnections' from %u to %u",
+              m_bReuseConnections, settingValue.GetBoolean());
+    if (m_bReuseConnections != settingValue.GetBoolean())
+    {
+      m_bReuseConnections = settingValue.GetBoolean();
+      return ADDON_STATUS_NEED_RESTART;
+    }
+  }
+  else if (settingName == "epgcachehours")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed setting 'epgcachehours' from %u to %u", m_iEpgCacheHours,
+              settingValue.GetInt());
+    m_iEpgCacheHours = settingValue.GetInt();
+  }
+  else if (settingName == "epgprefetchthreads")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed setting 'epgprefetchthreads' from %u to %u",
+              m_iEpgPrefetchThreads, settingValue.GetInt());
+    m_iEpgPrefetchThreads = settingValue.GetInt();
+  }
+  else if (settingName == "logodirectory")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed Setting 'logodirectory' from %s to %s",
+              m_szLogoDirectory.c_str(), settingValue.GetString().c_str());
+    if (m_szLogoDirectory != settingValue.GetString())
+    {
+      m_szLogoDirectory = settingValue.GetString();
+      return ADDON_STATUS_NEED_RESTART;
+    }
+  }
+  else if (settingName == "logocachesize")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed setting 'logocachesize' from %u to %u", m_iLogoCacheSize,
+              settingValue.GetInt());
+    if (m_iLogoCacheSize != settingValue.GetInt())
+    {
+      // The running logo cache got its limit at the start
+      m_iLogoCacheSize = settingValue.GetInt();
+      return ADDON_STATUS_NEED_RESTART;
+    }
+  }
+  else if (settingName == "readaheadsize")
+  {
+    kodi::Log(ADDON_LOG_INFO, "Changed setting 'readaheadsize' from %u to %u", m_iReadAheadSize,
+              settingValue.GetInt());
+    m_iReadAheadSize = settingValue.GetInt();
+  }
 
   return ADDON_STATUS_OK;
 }
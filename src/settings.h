@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <kodi/AddonBase.h>
 
 #define DEFAULT_HOST "127.0.0.1"
@@ -17,6 +18,18 @@
 #define DEFAULT_PASS ""
 #define DEFAULT_TUNEDELAY 200
 #define DEFAULT_USEFOLDER false
+#define DEFAULT_RECORDINGSTHREADS 4
+#define DEFAULT_REUSECONNECTIONS true
+#define DEFAULT_EPGCACHEHOURS 12
+#define DEFAULT_EPGPREFETCHTHREADS 4
+#define DEFAULT_LOGODIRECTORY ""
+#define DEFAULT_LOGOCACHESIZE 16
+#define DEFAULT_READAHEADSIZE 8
+
+// Upper bounds of the worker pools. Together with the logo workers they stay below
+// ATV_MAX_BULK_CONNECTIONS, so bulk downloads never wait for each other's slots.
+#define MAX_RECORDINGSTHREADS 4
+#define MAX_EPGPREFETCHTHREADS 4
 
 class CSettings
 {
@@ -40,6 +53,16 @@ public:
   const std::string& Pass() const { return m_szPass; }
   int TuneDelay() const { return m_iTuneDelay; }
   bool UseFolder() const { return m_bUseFolder; }
+  int RecordingsThreads() const { return std::min(m_iRecordingsThreads, MAX_RECORDINGSTHREADS); }
+  bool ReuseConnections() const { return m_bReuseConnections; }
+  int EpgCacheHours() const { return m_iEpgCacheHours; }
+  int EpgPrefetchThreads() const
+  {
+    return std::min(m_iEpgPrefetchThreads, MAX_EPGPREFETCHTHREADS);
+  }
+  const std::string& LogoDirectory() const { return m_szLogoDirectory; }
+  int LogoCacheSize() const { return m_iLogoCacheSize; }
+  int ReadAheadSize() const { return m_iReadAheadSize; }
 
 private:
   std::string m_szHostname = DEFAULT_HOST;
@@ -50,4 +73,11 @@ private:
   std::string m_szPass = DEFAULT_PASS;
   int m_iTuneDelay = DEFAULT_TUNEDELAY;
   bool m_bUseFolder = DEFAULT_USEFOLDER;
+  int m_iRecordingsThreads = DEFAULT_RECORDINGSTHREADS;
+  bool m_bReuseConnections = DEFAULT_REUSECONNECTIONS;
+  int m_iEpgCacheHours = DEFAULT_EPGCACHEHOURS;
+  int m_iEpgPrefetchThreads = DEFAULT_EPGPREFETCHTHREADS;
+  std::string m_szLogoDirectory = DEFAULT_LOGODIRECTORY;
+  int m_iLogoCacheSize = DEFAULT_LOGOCACHESIZE;
+  int m_iReadAheadSize = DEFAULT_READAHEADSIZE;
 };
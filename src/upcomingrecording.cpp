@@ -18,17 +18,12 @@
 bool cUpcomingRecording::Parse(const Json::Value& data)
 {
   int offset;
-  std::string t;
-  Json::Value channelobject, programobject;
-
-  programobject = data["Program"];
+  const Json::Value& programobject = data["Program"];
   date = 0;
 
   id = programobject["Id"].asInt();
-  t = programobject["StartTime"].asString();
-  starttime = CArgusTV::WCFDateToTimeT(t, offset);
-  t = programobject["StopTime"].asString();
-  stoptime = CArgusTV::WCFDateToTimeT(t, offset);
+  starttime = CArgusTV::WCFDateToTimeT(programobject["StartTime"], offset);
+  stoptime = CArgusTV::WCFDateToTimeT(programobject["StopTime"], offset);
   prerecordseconds = programobject["PreRecordSeconds"].asInt();
   postrecordseconds = programobject["PostRecordSeconds"].asInt();
   title = programobject["Title"].asString();
@@ -38,7 +33,7 @@ bool cUpcomingRecording::Parse(const Json::Value& data)
   scheduleid = programobject["ScheduleId"].asString();
 
   // From the Program class pickup the C# Channel class
-  channelobject = programobject["Channel"];
+  const Json::Value& channelobject = programobject["Channel"];
   channelid = channelobject["ChannelId"].asString();
   channeldisplayname = channelobject["DisplayName"].asString();
   ichannelid = channelobject["Id"].asInt();
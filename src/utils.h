@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <ctime>
 #include <json/json.h>
 #include <string>
 
@@ -36,3 +37,8 @@ std::string ToCIFS(std::string& UNCName);
 std::string ToUNC(std::string& CIFSName);
 std::string ToUNC(const char* CIFSName);
 bool InsertUser(const CArgusTVAddon& base, std::string& UNCName);
+
+/**
+ * \brief Thread safe replacement for localtime()
+ */
+struct tm LocalTime(time_t time);